@@ -0,0 +1,496 @@
+/*
+
+  delphioracle native benchmark
+
+  Drives the contract's hot actions (write, writehash, claim, the
+  eosio.token transfer notifier, votebounty, refreshvotes, the
+  sweepusers score sweep over the donors, deletepair with its
+  teardown calls and the read-only get* queries), plus a consumer contract reading each pair's price
+  from the datapoints scope and from the latest row, against the in-memory
+  chain from bench/include/eosio, with synthetic producers, oracles,
+  pairs and donors. Reports per-action wall time and database activity
+  so changes can be compared before they are deployed.
+
+  Usage: delphioracle_bench [--producers N] [--oracles N] [--pairs N]
+                            [--rounds N] [--donations N] [--window N]
+                            [--oracle-rank N] [--vote-interval N]
+                            [--packed] [--batch] [--hex-chaining]
+                            [--sweep-batch N] [--seed N] [--trace]
+
+  --oracle-rank picks the oracles from that producer rank down instead
+  of the top of the schedule, --vote-interval sets how many datapoints
+  trigger a vote refresh, --packed moves every pair to the single-row
+  windows layout with packwindow before the measured rounds, --batch
+  pushes the rounds with writebatch instead of write, and --hex-chaining
+  switches writehash to the original hex-encoded multiparty chaining.
+  --sweep-batch sets how many users each sweepusers call scores.
+
+*/
+
+#include <delphioracle.hpp>
+#include <latest.hpp>
+
+#include <eosio/native.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+
+namespace {
+
+  const name contract_account = "delphioracle"_n;
+  const name token_account = "eosio.token"_n;
+  const name system_account = "eosio"_n;
+  const name custodian_account = "custodian"_n;
+  const name consumer_account = "consumer"_n;
+  const name derived_pair = "pairxcross"_n;
+
+  struct options {
+    uint32_t producers = 105;
+    uint32_t oracles = 21;
+    uint32_t pairs = 10;
+    uint32_t rounds = 30;
+    uint32_t donations = 50;
+    uint32_t window = 21;
+    uint32_t oracle_rank = 0;
+    uint64_t vote_interval = 10000;
+    uint64_t sweep_batch = 20;
+    uint64_t seed = 1;
+    bool packed = false;
+    bool batch = false;
+    bool hex_chaining = false;
+    bool trace = false;
+  };
+
+  struct action_report {
+    std::string label;
+    std::vector<double> wall_us;
+    native::db_counters db;
+    uint64_t inline_actions = 0;
+    uint64_t console_bytes = 0;
+    uint64_t return_bytes = 0;
+  };
+
+  std::vector<action_report> reports;
+  options opts;
+
+  action_report& report_for(const std::string& label) {
+    for (auto& r : reports) {
+      if (r.label == label) return r;
+    }
+    reports.push_back(action_report{label});
+    return reports.back();
+  }
+
+  //Deterministic valid account names: prefix followed by four letters
+  name synthetic_name(const std::string& prefix, uint32_t i) {
+    std::string s = prefix;
+    for (int d = 3; d >= 0; --d) {
+      uint32_t p = 1;
+      for (int k = 0; k < d; ++k) p *= 26;
+      s += char('a' + (i / p) % 26);
+    }
+    return name(s);
+  }
+
+  //Runs one action the way apply() would: fresh context, contract object
+  //built from the receiver, arguments taken from the packed action data.
+  template<typename F>
+  void apply(const std::string& label, name first_receiver, name act, std::vector<char> data,
+             std::vector<name> auths, F&& f) {
+
+    native::begin_action(contract_account, first_receiver, act, std::move(data), std::move(auths));
+
+    const auto& action_data = native::current_action_data();
+    auto before = native::counters();
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+      delphioracle c(contract_account, first_receiver, datastream<const char*>(action_data.data(), action_data.size()));
+      f(c);
+    }
+    catch (const native::check_failure& e) {
+      std::fprintf(stderr, "%s failed: %s\n", label.c_str(), e.what());
+      std::exit(1);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    auto& r = report_for(label);
+    r.wall_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    r.db += native::counters() - before;
+    r.inline_actions += native::inline_actions().size();
+    r.console_bytes += native::console().size();
+
+    if (opts.trace && !native::console().empty()) {
+      std::printf("[%s] %s\n", label.c_str(), native::console().c_str());
+    }
+  }
+
+  //Runs a read by another contract in its own context and reports it like an action
+  template<typename F>
+  void consume(const std::string& label, F&& f) {
+
+    native::begin_action(consumer_account, consumer_account, "consume"_n, {}, {});
+
+    auto before = native::counters();
+    auto start = std::chrono::steady_clock::now();
+
+    f();
+
+    auto end = std::chrono::steady_clock::now();
+
+    auto& r = report_for(label);
+    r.wall_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    r.db += native::counters() - before;
+  }
+
+  template<typename... Params, typename... Args>
+  void push(name act, std::vector<name> auths, void (delphioracle::*fn)(Params...), Args&&... args) {
+    std::tuple<std::decay_t<Params>...> params{std::forward<Args>(args)...};
+    auto data = pack(params);
+    apply(act.to_string(), contract_account, act, std::move(data), std::move(auths), [&](delphioracle& c) {
+      std::apply([&](auto&... p) { (c.*fn)(p...); }, params);
+    });
+  }
+
+  //Runs an action that also returns a value. Packing the value for set_action_return_value is timed
+  //apart from the action under "<action> return", so the two can be compared
+  template<typename R, typename... Params, typename... Args>
+  void push(name act, std::vector<name> auths, R (delphioracle::*fn)(Params...), Args&&... args) {
+    std::tuple<std::decay_t<Params>...> params{std::forward<Args>(args)...};
+    auto data = pack(params);
+    R result = R();
+    apply(act.to_string(), contract_account, act, std::move(data), std::move(auths), [&](delphioracle& c) {
+      result = std::apply([&](auto&... p) { return (c.*fn)(p...); }, params);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    auto returned = pack(result);
+    auto end = std::chrono::steady_clock::now();
+
+    report_for(act.to_string()).return_bytes += returned.size();
+    report_for(act.to_string() + " return").wall_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  //Runs an action that answers through its return value, packed the way the dispatcher
+  //hands it to set_action_return_value
+  template<typename R, typename... Params, typename... Args>
+  void query(name act, R (delphioracle::*fn)(Params...), Args&&... args) {
+    std::tuple<std::decay_t<Params>...> params{std::forward<Args>(args)...};
+    auto data = pack(params);
+    std::size_t returned = 0;
+    apply(act.to_string(), contract_account, act, std::move(data), {}, [&](delphioracle& c) {
+      returned = pack(std::apply([&](auto&... p) { return (c.*fn)(p...); }, params)).size();
+    });
+    report_for(act.to_string()).return_bytes += returned;
+  }
+
+  void transfer(const std::string& label, name from, const asset& quantity, const std::string& memo) {
+    delphioracle::st_transfer t{from, contract_account, quantity, memo};
+    apply(label, token_account, "transfer"_n, pack(t), {from}, [&](delphioracle& c) {
+      c.transfer(token_account.value, contract_account.value);
+    });
+  }
+
+  asset eos(int64_t amount) {
+    return asset(amount, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+  }
+
+  //Seeds eosio::producers ranked by descending votes and eosio::voters
+  //for the donors, with half of them proxying to the contract.
+  void seed_system_tables(const std::vector<name>& producers, const std::vector<name>& donors) {
+
+    native::begin_action(system_account, system_account, "init"_n, {}, {system_account});
+
+    delphioracle::producers_table ptable(system_account, system_account.value);
+    for (std::size_t i = 0; i < producers.size(); ++i) {
+      ptable.emplace(system_account, [&](auto& p) {
+        p.owner = producers[i];
+        p.total_votes = double(producers.size() - i) * 1e12;
+        p.is_active = true;
+        p.url = "https://" + producers[i].to_string() + ".example";
+      });
+    }
+
+    delphioracle::voters_table vtable(system_account, system_account.value);
+    for (std::size_t i = 0; i < donors.size(); ++i) {
+      vtable.emplace(system_account, [&](auto& v) {
+        v.owner = donors[i];
+        v.proxy = (i % 2 == 0) ? contract_account : name();
+        v.staked = int64_t(1000000 + i * 10000);
+      });
+    }
+
+  }
+
+  bool claimable(name oracle) {
+    native::begin_action(contract_account, contract_account, "inspect"_n, {}, {});
+    delphioracle::statstable stats(contract_account, contract_account.value);
+    auto itr = stats.find(oracle.value);
+    delphioracle::rewardstable rewards(contract_account, contract_account.value);
+    return itr != stats.end() && (itr->balance.amount > 0 || rewards.begin() != rewards.end());
+  }
+
+  bool vote_refresh_due() {
+    native::begin_action(contract_account, contract_account, "inspect"_n, {}, {});
+    delphioracle::votestatetable vstate(contract_account, contract_account.value);
+    auto itr = vstate.find(1);
+    return itr != vstate.end() && itr->due;
+  }
+
+  bool sweep_running() {
+    native::begin_action(contract_account, contract_account, "inspect"_n, {}, {});
+    delphioracle::sweepstatetable sstate(contract_account, contract_account.value);
+    auto itr = sstate.find(1);
+    return itr != sstate.end() && itr->running;
+  }
+
+  bool teardown_pending() {
+    native::begin_action(contract_account, contract_account, "inspect"_n, {}, {});
+    delphioracle::teardownstable teardowns(contract_account, contract_account.value);
+    return teardowns.begin() != teardowns.end();
+  }
+
+  double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    auto i = std::size_t(p * double(v.size() - 1) + 0.5);
+    return v[std::min(i, v.size() - 1)];
+  }
+
+  void print_report() {
+
+    std::printf("\n%-22s %6s %9s %9s %9s %8s %8s %8s %8s %9s %9s %7s %9s\n",
+                "action", "calls", "mean us", "p50 us", "max us",
+                "db rd", "db wr", "idx rd", "idx wr", "bytes rd", "bytes wr", "inline", "ret bytes");
+
+    for (const auto& r : reports) {
+      double n = double(r.wall_us.size());
+      double total = 0;
+      for (auto w : r.wall_us) total += w;
+
+      std::printf("%-22s %6zu %9.2f %9.2f %9.2f %8.1f %8.1f %8.1f %8.1f %9.0f %9.0f %7.2f %9.0f\n",
+                  r.label.c_str(), r.wall_us.size(), total / n, percentile(r.wall_us, 0.5),
+                  *std::max_element(r.wall_us.begin(), r.wall_us.end()),
+                  r.db.reads / n, r.db.writes / n, r.db.idx_reads / n, r.db.idx_writes / n,
+                  r.db.bytes_read / n, r.db.bytes_written / n, r.inline_actions / n, r.return_bytes / n);
+    }
+
+    std::printf("\nram billed to %s: %lld bytes\n", contract_account.to_string().c_str(),
+                (long long)native::ram_usage(contract_account));
+
+  }
+
+  bool parse_options(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      auto value = [&]() -> uint64_t {
+        if (i + 1 >= argc) {
+          std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+          std::exit(2);
+        }
+        return std::strtoull(argv[++i], nullptr, 10);
+      };
+
+      if (arg == "--producers") opts.producers = value();
+      else if (arg == "--oracles") opts.oracles = value();
+      else if (arg == "--pairs") opts.pairs = value();
+      else if (arg == "--rounds") opts.rounds = value();
+      else if (arg == "--donations") opts.donations = value();
+      else if (arg == "--window") opts.window = value();
+      else if (arg == "--oracle-rank") opts.oracle_rank = value();
+      else if (arg == "--vote-interval") opts.vote_interval = value();
+      else if (arg == "--sweep-batch") opts.sweep_batch = value();
+      else if (arg == "--seed") opts.seed = value();
+      else if (arg == "--packed") opts.packed = true;
+      else if (arg == "--batch") opts.batch = true;
+      else if (arg == "--hex-chaining") opts.hex_chaining = true;
+      else if (arg == "--trace") opts.trace = true;
+      else {
+        std::fprintf(stderr, "usage: %s [--producers N] [--oracles N] [--pairs N] [--rounds N] [--donations N] [--window N] [--oracle-rank N] [--vote-interval N] [--packed] [--batch] [--hex-chaining] [--sweep-batch N] [--seed N] [--trace]\n", argv[0]);
+        return false;
+      }
+    }
+
+    if (opts.oracles == 0 || opts.oracle_rank + opts.oracles > opts.producers || opts.pairs == 0 ||
+        opts.window == 0 || opts.vote_interval == 0) {
+      std::fprintf(stderr, "need 0 < oracles, oracle-rank + oracles <= producers, at least one pair, "
+                           "a non-empty window and a non-zero vote interval\n");
+      return false;
+    }
+    return true;
+  }
+
+}
+
+int main(int argc, char** argv) {
+
+  if (!parse_options(argc, argv)) return 2;
+
+  std::mt19937_64 rng(opts.seed);
+
+  std::vector<name> producers;
+  for (uint32_t i = 0; i < opts.producers; ++i) producers.push_back(synthetic_name("producer", i));
+
+  std::vector<name> oracles(producers.begin() + opts.oracle_rank, producers.begin() + opts.oracle_rank + opts.oracles);
+
+  std::vector<name> donors;
+  for (uint32_t i = 0; i < std::max(opts.donations, 1u); ++i) donors.push_back(synthetic_name("donor", i));
+
+  std::vector<name> pairs{"eosusd"_n};
+  for (uint32_t i = 1; i < opts.pairs; ++i) pairs.push_back(synthetic_name("pair", i));
+
+  native::set_time(time_point(seconds(1767225600)));
+
+  seed_system_tables(producers, donors);
+
+  delphioracle::globalinput g{opts.window, 30, opts.vote_interval, 55000000, 1, 2, 1, 105, 21, 604800, 259200};
+  push("configure"_n, {contract_account}, &delphioracle::configure, g);
+  if (opts.hex_chaining) push("setchainmode"_n, {contract_account}, &delphioracle::setchainmode, true);
+  push("addcustodian"_n, {contract_account}, &delphioracle::addcustodian, custodian_account);
+
+  std::vector<uint64_t> prices;
+  for (std::size_t p = 0; p < pairs.size(); ++p) prices.push_back(10000 + rng() % 90000);
+
+  auto next_round = [&]() {
+    native::advance_time(microseconds(g.write_cooldown) + seconds(5));
+  };
+
+  auto quotes_for = [&](std::size_t count) {
+    std::vector<delphioracle::quote> quotes;
+    for (std::size_t p = 0; p < count; ++p) {
+      int64_t jitter = int64_t(rng() % 201) - 100;
+      quotes.push_back({uint64_t(int64_t(prices[p]) + int64_t(prices[p]) * jitter / 10000), pairs[p]});
+    }
+    return quotes;
+  };
+
+  //Round zero on the default pair gives every oracle the datapoint count
+  //needed to approve bounties
+  for (const auto& o : oracles) push("write"_n, {o}, &delphioracle::write, o, quotes_for(1));
+
+  for (std::size_t p = 1; p < pairs.size(); ++p) {
+    delphioracle::pairinput pi{pairs[p], symbol("EOS", 4), delphioracle::e_asset_type::eosio_token, token_account,
+                               symbol("USD", 2), delphioracle::e_asset_type::fiat, name(), 4};
+    push("newbounty"_n, {donors[0]}, &delphioracle::newbounty, donors[0], pi);
+    transfer("transfer (bounty)", donors[p % donors.size()], eos(1000000), pairs[p].to_string());
+
+    push("votebounty"_n, {custodian_account}, &delphioracle::votebounty, custodian_account, pairs[p]);
+    for (uint32_t v = 0; v < std::min<uint32_t>(2, opts.oracles); ++v) {
+      push("votebounty"_n, {oracles[v]}, &delphioracle::votebounty, oracles[v], pairs[p]);
+    }
+  }
+
+  if (opts.packed) {
+    for (const auto& p : pairs) push("packwindow"_n, {contract_account}, &delphioracle::packwindow, p);
+  }
+
+  std::vector<std::string> reveals(oracles.size());
+
+  for (uint32_t round = 0; round < opts.rounds; ++round) {
+
+    next_round();
+
+    for (std::size_t o = 0; o < oracles.size(); ++o) {
+      if (opts.batch) push("writebatch"_n, {oracles[o]}, &delphioracle::writebatch, oracles[o], quotes_for(pairs.size()));
+      else push("write"_n, {oracles[o]}, &delphioracle::write, oracles[o], quotes_for(pairs.size()));
+
+      std::string secret = oracles[o].to_string() + "-" + std::to_string(round) + "-" + std::to_string(rng());
+      auto commitment = sha256(secret.c_str(), secret.size());
+      push("writehash"_n, {oracles[o]}, &delphioracle::writehash, oracles[o], commitment, reveals[o]);
+      reveals[o] = secret;
+    }
+
+    while (vote_refresh_due()) push("refreshvotes"_n, {oracles[0]}, &delphioracle::refreshvotes);
+
+    for (auto& p : prices) p = uint64_t(int64_t(p) + int64_t(p) * (int64_t(rng() % 101) - 50) / 10000);
+
+  }
+
+  for (uint32_t d = 0; d < opts.donations; ++d) {
+    const auto& donor = donors[d % donors.size()];
+    bool to_pair = d % 2 == 1;
+    transfer(to_pair ? "transfer (pair)" : "transfer (global)", donor, eos(10000 + int64_t(rng() % 1000000)),
+             to_pair ? pairs[0].to_string() : std::string(""));
+  }
+
+  //A keeper calls it again while the sweep is running
+  do push("sweepusers"_n, {contract_account}, &delphioracle::sweepusers, opts.sweep_batch);
+  while (sweep_running());
+
+  for (const auto& o : oracles) {
+    if (claimable(o)) push("claim"_n, {o}, &delphioracle::claim, o);
+  }
+
+  //What a consumer contract pays to read each pair's current median
+  uint64_t consumed = 0;
+  for (const auto& p : pairs) {
+    if (!opts.packed) {
+      consume("consume (datapoints)", [&]() {
+        delphioracle::datapointstable dstore(contract_account, p.value);
+        auto t_idx = dstore.get_index<"timestamp"_n>();
+        auto itr = t_idx.end();
+        if (itr != t_idx.begin()) consumed += (--itr)->median;
+      });
+    }
+    consume("consume (latest)", [&]() {
+      delphi::latest_price price;
+      if (delphi::read_latest(contract_account, p, price)) consumed += delphi::median_as<4>(price);
+    });
+  }
+  if (consumed == 0) std::fprintf(stderr, "no price was read\n");
+
+  //TWAP over the last two checkpoint periods, up to now
+  uint32_t twap_to = time_point_sec(native::now()).sec_since_epoch();
+  uint32_t twap_from = twap_to - 2 * delphi::twap_checkpoint_interval;
+  for (const auto& p : pairs) {
+    consume("consume (twap)", [&]() {
+      uint64_t average;
+      if (delphi::read_twap(contract_account, p, twap_from, twap_to, average)) consumed += average;
+    });
+  }
+
+  //A cross rate of the first two pairs, computed on read instead of written by the oracles
+  if (pairs.size() > 1) {
+    std::vector<delphioracle::derived_leg> legs{{pairs[0], false}, {pairs[1], true}};
+    push("setderived"_n, {contract_account}, &delphioracle::setderived, derived_pair, legs, uint64_t(6));
+    consume("consume (derived)", [&]() {
+      delphi::latest_price price;
+      if (delphi::read_derived(contract_account, derived_pair, price)) consumed += price.median;
+    });
+    query("getderived"_n, &delphioracle::getderived, derived_pair);
+  }
+
+  //The read-only queries dashboards and bots use instead of get_table_rows
+  for (const auto& p : pairs) {
+    query("getlatest"_n, &delphioracle::getlatest, p);
+    query("getwindow"_n, &delphioracle::getwindow, p);
+    query("getbars"_n, &delphioracle::getbars, p, "minute"_n, time_point_sec(), time_point_sec(native::now()), uint32_t(500));
+    query("getleaders"_n, &delphioracle::getleaders, p);
+    query("getstats"_n, &delphioracle::getstats, oracles[0], p);
+    query("gettwap"_n, &delphioracle::gettwap, p, time_point_sec(twap_from), time_point_sec(twap_to));
+  }
+
+  //Last, so the pair's bars and stats are as large as the run made them
+  if (pairs.size() > 1) {
+    push("delderived"_n, {contract_account}, &delphioracle::delderived, derived_pair);
+    push("deletepair"_n, {contract_account}, &delphioracle::deletepair, pairs.back(), std::string("bench"));
+    while (teardown_pending()) push("teardown"_n, {oracles[0]}, &delphioracle::teardown, uint64_t(100));
+  }
+
+  std::printf("delphioracle native benchmark: %u producers, %u oracles, %u pairs, %u rounds, %u donations, window %u%s\n",
+              opts.producers, opts.oracles, opts.pairs, opts.rounds, opts.donations, opts.window,
+              opts.packed ? ", packed windows" : "");
+
+  print_report();
+
+  return 0;
+}
@@ -0,0 +1,1142 @@
+/*
+
+  delphioracle native scenario checks
+
+  Runs one scenario against the in-memory chain from bench/include/eosio
+  and checks what the contract stores against the behaviour it replaced
+  or against a direct computation:
+
+    hexchain    writehash digests in hex mode match the original scan of
+                the hashes table, sha256(hex(previous digest) + reveal)
+    evenmedian  an even window's median is the mean of its two middle
+                values, in the datapoints and in the packed layout
+    rollup      each closed hour and day bar holds the samples, high,
+                low, open and close of the finer bars it was merged from
+    payouts     lazily settled donations pay each oracle what the
+                original split over the top paid oracles paid, within
+                rounding, and a claim collects all of it
+    teardown    deletepair and teardown leave nothing of the pair in any
+                scope or table, including the settlement row of an
+                oracle that fell off the pair's leaderboard
+    twapgap     periods without a write have a checkpoint, so a TWAP
+                over them is the median in effect, and a range that
+                starts before the first write is clamped to it
+    clear       clear erases every pair's window, not only the one it is
+                given, so each pair can be proposed again afterwards
+    compactdons compactdons folds rows from before the donors total
+                and rows past the retention into it, leaves the total
+                voteabuser reads unchanged, needs the donator's or the
+                contract's authority, and donations in another symbol
+                are refused
+    migration   migratedata copies every delphibackup row in batches of
+                the size it is given, resuming at its cursor without a
+                separate counting pass, and defaults the batch when
+                called without arguments
+    abuse       an oracle flagged by abuse votes is refused by write and
+                writehash, and accepted again once the votes are
+                withdrawn
+    sweep       sweepusers resumes at its cursor across calls and adds
+                each proxying user's stake once, as updateusers does in
+                one call
+    derived     a derived pair reads as the cross rate of its legs'
+                latest medians, and its legs must be active and cannot
+                be deleted while it uses them
+
+  Usage: delphioracle_checks <scenario>
+
+  Exits with 1 when a check fails, so ctest runs each scenario as a test.
+
+*/
+
+#include <delphioracle.hpp>
+#include <latest.hpp>
+
+#include <eosio/native.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+
+namespace {
+
+  const name contract_account = "delphioracle"_n;
+  const name token_account = "eosio.token"_n;
+  const name system_account = "eosio"_n;
+  const name custodian_account = "custodian"_n;
+  const name default_pair = "eosusd"_n;
+
+  const uint64_t write_cooldown = 55000000;
+
+  int failures = 0;
+
+  void expect(bool ok, const std::string& what) {
+    if (ok) return;
+    std::fprintf(stderr, "FAILED: %s\n", what.c_str());
+    failures++;
+  }
+
+  //Deterministic valid account names: prefix followed by four letters
+  name synthetic_name(const std::string& prefix, uint32_t i) {
+    std::string s = prefix;
+    for (int d = 3; d >= 0; --d) {
+      uint32_t p = 1;
+      for (int k = 0; k < d; ++k) p *= 26;
+      s += char('a' + (i / p) % 26);
+    }
+    return name(s);
+  }
+
+  //Runs one action the way apply() would and returns what the action returns. A failed check ends
+  //the scenario, the contract refused a step the scenario relies on
+  template<typename R, typename... Params, typename... Args>
+  R call(name act, std::vector<name> auths, R (delphioracle::*fn)(Params...), Args&&... args) {
+    std::tuple<std::decay_t<Params>...> params{std::forward<Args>(args)...};
+
+    native::begin_action(contract_account, contract_account, act, pack(params), std::move(auths));
+
+    const auto& action_data = native::current_action_data();
+
+    try {
+      delphioracle c(contract_account, contract_account, datastream<const char*>(action_data.data(), action_data.size()));
+      return std::apply([&](auto&... p) { return (c.*fn)(p...); }, params);
+    }
+    catch (const native::check_failure& e) {
+      std::fprintf(stderr, "%s failed: %s\n", act.to_string().c_str(), e.what());
+      std::exit(1);
+    }
+  }
+
+  //Runs one action that the scenario expects the contract to refuse, true when a check failed
+  template<typename R, typename... Params, typename... Args>
+  bool refused(name act, std::vector<name> auths, R (delphioracle::*fn)(Params...), Args&&... args) {
+    std::tuple<std::decay_t<Params>...> params{std::forward<Args>(args)...};
+
+    native::begin_action(contract_account, contract_account, act, pack(params), std::move(auths));
+
+    const auto& action_data = native::current_action_data();
+
+    try {
+      delphioracle c(contract_account, contract_account, datastream<const char*>(action_data.data(), action_data.size()));
+      std::apply([&](auto&... p) { (c.*fn)(p...); }, params);
+    }
+    catch (const native::check_failure&) {
+      return true;
+    }
+
+    return false;
+  }
+
+  //Notifies the contract of a transfer to it, false when the notifier refused it
+  bool try_transfer(name from, const asset& quantity, const std::string& memo) {
+    delphioracle::st_transfer t{from, contract_account, quantity, memo};
+
+    native::begin_action(contract_account, token_account, "transfer"_n, pack(t), {from});
+
+    const auto& action_data = native::current_action_data();
+
+    try {
+      delphioracle c(contract_account, token_account, datastream<const char*>(action_data.data(), action_data.size()));
+      c.transfer(token_account.value, contract_account.value);
+    }
+    catch (const native::check_failure& e) {
+      std::fprintf(stderr, "transfer refused: %s\n", e.what());
+      return false;
+    }
+
+    return true;
+  }
+
+  void transfer(name from, const asset& quantity, const std::string& memo) {
+    if (!try_transfer(from, quantity, memo)) std::exit(1);
+  }
+
+  //Context for reading the contract's tables between actions
+  void inspect() {
+    native::begin_action(contract_account, contract_account, "inspect"_n, {}, {});
+  }
+
+  asset eos(int64_t amount) {
+    return asset(amount, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+  }
+
+  std::vector<delphioracle::quote> quote(uint64_t value, name pair) {
+    return {{value, pair}};
+  }
+
+  struct chain {
+    std::vector<name> oracles;
+    std::vector<name> donors;
+    delphioracle::globalinput config;
+  };
+
+  //Seeds the system tables with ranked producers, the first of which are the oracles, configures the
+  //contract and adds a custodian. The clock starts at a day boundary
+  chain setup(uint32_t oracles, uint64_t window, uint64_t paid) {
+
+    chain c;
+
+    std::vector<name> producers;
+    for (uint32_t i = 0; i < std::max<uint32_t>(30, oracles); ++i) producers.push_back(synthetic_name("producer", i));
+    for (uint32_t i = 0; i < 4; ++i) c.donors.push_back(synthetic_name("donor", i));
+
+    c.oracles.assign(producers.begin(), producers.begin() + oracles);
+
+    native::set_time(time_point(seconds(1767225600)));
+
+    native::begin_action(system_account, system_account, "init"_n, {}, {system_account});
+
+    delphioracle::producers_table ptable(system_account, system_account.value);
+    for (std::size_t i = 0; i < producers.size(); ++i) {
+      ptable.emplace(system_account, [&](auto& p) {
+        p.owner = producers[i];
+        p.total_votes = double(producers.size() - i) * 1e12;
+        p.is_active = true;
+        p.url = "https://" + producers[i].to_string() + ".example";
+      });
+    }
+
+    delphioracle::voters_table vtable(system_account, system_account.value);
+    for (std::size_t i = 0; i < c.donors.size(); ++i) {
+      vtable.emplace(system_account, [&](auto& v) {
+        v.owner = c.donors[i];
+        v.proxy = contract_account;
+        v.staked = int64_t(1000000 + i * 10000);
+      });
+    }
+
+    c.config = delphioracle::globalinput{window, 30, 10000, write_cooldown, 1, 2, 1, 105, paid, 604800, 259200};
+
+    call("configure"_n, {contract_account}, &delphioracle::configure, c.config);
+    call("addcustodian"_n, {contract_account}, &delphioracle::addcustodian, custodian_account);
+
+    return c;
+
+  }
+
+  void next_round() {
+    native::advance_time(microseconds(write_cooldown) + seconds(5));
+  }
+
+  //Proposes pair and funds its bounty with amount larimers
+  void propose_pair(const chain& c, name pair, int64_t amount) {
+
+    delphioracle::pairinput pi{pair, symbol("EOS", 4), delphioracle::e_asset_type::eosio_token, token_account,
+                               symbol("USD", 2), delphioracle::e_asset_type::fiat, name(), 4};
+
+    call("newbounty"_n, {c.donors[0]}, &delphioracle::newbounty, c.donors[0], pi);
+    transfer(c.donors[1], eos(amount), pair.to_string());
+
+  }
+
+  //Proposes pair, funds its bounty with amount larimers and approves it
+  void add_pair(const chain& c, name pair, int64_t amount) {
+
+    propose_pair(c, pair, amount);
+
+    call("votebounty"_n, {custodian_account}, &delphioracle::votebounty, custodian_account, pair);
+    for (uint32_t v = 0; v < 2; ++v) call("votebounty"_n, {c.oracles[v]}, &delphioracle::votebounty, c.oracles[v], pair);
+
+  }
+
+  std::string hex(const checksum256& h) {
+    auto bytes = h.extract_as_byte_array();
+    const char* digits = "0123456789abcdef";
+    std::string s;
+    for (auto b : bytes) {
+      s += digits[b >> 4];
+      s += digits[b & 0x0f];
+    }
+    return s;
+  }
+
+  //The digest the contract computed before the chaining row: the newest revealed row of another oracle,
+  //its digest as hex text followed by the reveal
+  checksum256 original_multiparty(name owner, const std::string& reveal) {
+
+    if (reveal == "") return checksum256();
+
+    inspect();
+
+    delphioracle::hashestable hstore(contract_account, contract_account.value);
+
+    for (auto itr = hstore.rbegin(); itr != hstore.rend(); ++itr) {
+      if (itr->owner == owner || itr->reveal == "") continue;
+      std::string to_hash = hex(itr->multiparty) + reveal;
+      return sha256(to_hash.c_str(), to_hash.size());
+    }
+
+    return checksum256();
+
+  }
+
+  void check_hexchain() {
+
+    chain c = setup(4, 21, 21);
+
+    call("setchainmode"_n, {contract_account}, &delphioracle::setchainmode, true);
+
+    std::mt19937_64 rng(1);
+    std::vector<std::string> reveals(c.oracles.size());
+    uint32_t chained = 0;
+
+    for (uint32_t round = 0; round < 12; ++round) {
+
+      next_round();
+
+      for (std::size_t o = 0; o < c.oracles.size(); ++o) {
+
+        const name owner = c.oracles[o];
+
+        //one oracle skips rounds and another forfeits its hash, so the chain is rebuilt from the table
+        if (o == 1 && round % 3 == 2) continue;
+        if (o == 2 && round == 6) {
+          call("forfeithash"_n, {owner}, &delphioracle::forfeithash, owner);
+          reveals[o] = "";
+          continue;
+        }
+
+        checksum256 expected = original_multiparty(owner, reveals[o]);
+
+        std::string secret = owner.to_string() + "-" + std::to_string(round) + "-" + std::to_string(rng());
+        call("writehash"_n, {owner}, &delphioracle::writehash, owner, sha256(secret.c_str(), secret.size()), reveals[o]);
+
+        inspect();
+
+        delphioracle::hashestable hstore(contract_account, contract_account.value);
+        auto o_idx = hstore.get_index<"owner"_n>();
+        auto itr = o_idx.find(owner.value);
+
+        expect(itr != o_idx.end() && itr->multiparty == expected,
+               "round " + std::to_string(round) + ": digest of " + owner.to_string() + " differs from the hex scan");
+
+        if (expected != checksum256()) chained++;
+        reveals[o] = secret;
+
+      }
+
+    }
+
+    expect(chained > 30, "too few chained digests to compare");
+
+  }
+
+  void check_evenmedian() {
+
+    const uint64_t window = 4;
+
+    chain c = setup(4, window, 21);
+
+    std::mt19937_64 rng(2);
+
+    //new pairs start with a window of placeholder zeros, the oldest point is replaced first
+    std::deque<uint64_t> points(window, 0);
+    uint32_t compared = 0;
+
+    for (bool packed : {false, true}) {
+
+      if (packed) call("packwindow"_n, {contract_account}, &delphioracle::packwindow, default_pair);
+
+      for (uint32_t round = 0; round < 6; ++round) {
+
+        next_round();
+
+        for (const auto& owner : c.oracles) {
+
+          uint64_t value = 1000 + rng() % 9000;
+
+          auto results = call("write"_n, {owner}, &delphioracle::write, owner, quote(value, default_pair));
+
+          points.pop_front();
+          points.push_back(value);
+
+          std::vector<uint64_t> sorted(points.begin(), points.end());
+          std::sort(sorted.begin(), sorted.end());
+
+          uint64_t expected = (sorted[window / 2 - 1] + sorted[window / 2]) / 2;
+
+          inspect();
+
+          delphioracle::latesttable lstore(contract_account, contract_account.value);
+          auto litr = lstore.find(default_pair.value);
+
+          std::string where = std::string(packed ? "packed" : "datapoints") + " round " + std::to_string(round);
+
+          expect(results.size() == 1 && results[0].median == expected, where + ": write returned another median");
+          expect(litr != lstore.end() && litr->median == expected, where + ": latest row holds another median");
+
+          compared++;
+
+        }
+
+      }
+
+    }
+
+    expect(compared == 48, "not every write was compared");
+
+  }
+
+  //Checks every closed bar of a tier against the finer bars that fall in its interval
+  template<typename Coarse, typename Fine>
+  uint32_t check_tier(const std::string& tier, uint64_t interval) {
+
+    inspect();
+
+    Coarse coarse(contract_account, default_pair.value);
+    Fine fine(contract_account, default_pair.value);
+
+    uint32_t closed = 0;
+
+    for (auto itr = coarse.begin(); itr != coarse.end(); ++itr) {
+
+      //the latest bar is still open, finer bars keep closing into it
+      if (std::next(itr) == coarse.end()) break;
+
+      uint64_t start = itr->timestamp.sec_since_epoch();
+
+      uint64_t samples = 0;
+      uint64_t high = 0;
+      uint64_t low = UINT64_MAX;
+      uint64_t open = 0;
+      uint64_t close = 0;
+
+      for (const auto& b : fine) {
+        uint64_t at = b.timestamp.sec_since_epoch();
+        if (at < start || at >= start + interval) continue;
+        if (samples == 0) open = b.open;
+        samples += b.samples;
+        high = std::max(high, b.high);
+        low = std::min(low, b.low);
+        close = b.close;
+      }
+
+      std::string where = tier + " bar at " + std::to_string(start);
+
+      expect(samples > 0 && itr->samples == samples, where + ": samples differ from its finer bars");
+      expect(itr->high == high && itr->low == low, where + ": high or low differ from its finer bars");
+      expect(itr->open == open && itr->close == close, where + ": open or close differ from its finer bars");
+
+      closed++;
+
+    }
+
+    return closed;
+
+  }
+
+  void check_rollup() {
+
+    chain c = setup(2, 3, 21);
+
+    //enough minute bars to cover every hour that closes, and hour bars for the day that closes
+    call("setretention"_n, {contract_account}, &delphioracle::setretention, uint64_t(2000), uint64_t(100), uint64_t(10));
+
+    std::mt19937_64 rng(3);
+
+    uint64_t price = 50000;
+
+    for (uint32_t step = 0; step < 26 * 60; ++step) {
+      next_round();
+      for (const auto& owner : c.oracles) {
+        price = price + price * (rng() % 101) / 10000 - price * 50 / 10000;
+        call("write"_n, {owner}, &delphioracle::write, owner, quote(price, default_pair));
+      }
+    }
+
+    uint32_t hours = check_tier<delphioracle::hourbarstable, delphioracle::barstable>("hour", 3600);
+    uint32_t days = check_tier<delphioracle::daybarstable, delphioracle::hourbarstable>("day", 86400);
+
+    expect(hours >= 24, "fewer than 24 closed hour bars");
+    expect(days >= 1, "no closed day bar");
+
+  }
+
+  //What the contract paid each oracle when a donation came in, before the reward accumulator: the
+  //scope's top paid oracles by datapoints shared it prorated, the top one also taking what rounding left
+  bool original_split(name scope, uint64_t paid, int64_t amount, std::map<name, int64_t>& expected) {
+
+    inspect();
+
+    delphioracle::statstable stats(contract_account, scope.value);
+
+    std::vector<std::pair<uint64_t, name>> ranked;
+    for (const auto& s : stats) ranked.push_back({s.count, s.owner});
+
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+      return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    uint64_t upperbound = std::min<uint64_t>(ranked.size(), paid);
+
+    //who is paid on a tie at the last paid place depends on the ranking order, which changed
+    if (upperbound == 0) return false;
+    if (upperbound < ranked.size() && ranked[upperbound - 1].first == ranked[upperbound].first) return false;
+
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < upperbound; ++i) total += ranked[i].first;
+
+    int64_t left = amount;
+
+    for (uint64_t i = upperbound; i >= 1; --i) {
+      double percent = (double)ranked[i - 1].first / (double)total;
+      int64_t quota = (int64_t)(percent * (double)amount);
+      expected[ranked[i - 1].second] += i == 1 ? left : quota;
+      left -= quota;
+    }
+
+    return true;
+
+  }
+
+  void check_payouts() {
+
+    const uint64_t paid = 5;
+
+    chain c = setup(8, 21, paid);
+
+    std::mt19937_64 rng(4);
+
+    std::map<name, int64_t> expected;
+    uint32_t donations = 0;
+
+    for (uint32_t round = 0; round < 90; ++round) {
+
+      next_round();
+
+      //write rates change halfway, so oracles pass each other and leave or join the paid places
+      for (uint32_t o = 0; o < c.oracles.size(); ++o) {
+        uint32_t k = round < 45 ? o : uint32_t(c.oracles.size()) - 1 - o;
+        if ((round + o) % (k + 2) == 0) continue;
+        call("write"_n, {c.oracles[o]}, &delphioracle::write, c.oracles[o], quote(10000 + rng() % 1000, default_pair));
+      }
+
+      if (round % 3 != 2) continue;
+
+      bool global = round % 2 == 0;
+      int64_t amount = 10000 + int64_t(rng() % 1000000);
+
+      if (!original_split(global ? contract_account : default_pair, paid, amount, expected)) continue;
+
+      transfer(c.donors[round % c.donors.size()], eos(amount), global ? "" : default_pair.to_string());
+      donations++;
+
+    }
+
+    expect(donations >= 20, "too few donations to compare");
+
+    for (const auto& owner : c.oracles) {
+
+      inspect();
+
+      delphioracle::statstable gstore(contract_account, contract_account.value);
+      auto itr = gstore.find(owner.value);
+
+      int64_t balance = itr != gstore.end() ? itr->balance.amount : 0;
+
+      auto global = call("getstats"_n, {}, &delphioracle::getstats, owner, contract_account);
+      auto pair = call("getstats"_n, {}, &delphioracle::getstats, owner, default_pair);
+
+      int64_t earned = balance + global.pending.amount + pair.pending.amount;
+      int64_t original = expected[owner];
+
+      //both round each share down, the original gave what was left to the top oracle
+      expect(std::llabs(earned - original) <= int64_t(donations * paid),
+             owner.to_string() + " earned " + std::to_string(earned) + ", the original split paid " + std::to_string(original));
+
+      if (earned == 0) continue;
+
+      //claim pays the balance and what is pending in every scope, from the oracle's settlement rows
+      delphioracle::globaltable gtable(contract_account, contract_account.value);
+      int64_t claimed = gtable.begin()->total_claimed.amount;
+
+      call("claim"_n, {owner}, &delphioracle::claim, owner);
+
+      inspect();
+
+      delphioracle::globaltable after(contract_account, contract_account.value);
+      expect(after.begin()->total_claimed.amount - claimed == earned, owner.to_string() + " claimed other than it earned");
+
+    }
+
+  }
+
+  void check_teardown() {
+
+    const name pair = "pairtest"_n;
+
+    //a window larger than what deletepair erases on its own, so teardown has rows left to erase. One
+    //oracle more than the leaderboard holds, so one can fall off it
+    chain c = setup(31, 250, 21);
+
+    const std::vector<name> writers(c.oracles.begin(), c.oracles.begin() + 4);
+    const name dropped = c.oracles[4];
+
+    //approving a bounty takes a datapoint
+    for (const auto& owner : c.oracles) call("write"_n, {owner}, &delphioracle::write, owner, quote(10000, default_pair));
+
+    //a small bounty is awarded during the run, so the donation below goes to the pair's oracles
+    add_pair(c, pair, 50);
+
+    std::mt19937_64 rng(5);
+
+    for (uint32_t round = 0; round < 25; ++round) {
+      next_round();
+      for (const auto& owner : writers) {
+        std::vector<delphioracle::quote> quotes{{10000 + rng() % 1000, default_pair}, {20000 + rng() % 1000, pair}};
+        call("write"_n, {owner}, &delphioracle::write, owner, quotes);
+      }
+      if (round == 0) call("write"_n, {dropped}, &delphioracle::write, dropped, quote(20000, pair));
+    }
+
+    transfer(c.donors[2], eos(500000), pair.to_string());
+
+    //every other oracle passes the one that wrote once, which leaves the board holding its settlement row
+    for (uint32_t round = 0; round < 2; ++round) {
+      next_round();
+      for (auto itr = c.oracles.begin() + 5; itr != c.oracles.end(); ++itr) {
+        call("write"_n, {*itr}, &delphioracle::write, *itr, quote(20000 + rng() % 1000, pair));
+      }
+    }
+
+    inspect();
+
+    delphioracle::rewardstable before(contract_account, contract_account.value);
+    expect(before.find(pair.value) != before.end(), "the donation did not reach the pair's oracles");
+    expect(native::scope_rows(contract_account, pair.value) > 0, "the pair has no rows to tear down");
+
+    delphioracle::leaderboardtable boards(contract_account, contract_account.value);
+    auto bitr = boards.find(pair.value);
+    expect(bitr != boards.end() && std::none_of(bitr->leaders.begin(), bitr->leaders.end(), [&](const auto& l) {return l.owner == dropped;}),
+           "the oracle that wrote once is still on the leaderboard");
+
+    delphioracle::settlementstable held(contract_account, dropped.value);
+    expect(held.find(pair.value) != held.end(), "the oracle that wrote once has no settlement row");
+
+    call("deletepair"_n, {contract_account}, &delphioracle::deletepair, pair, std::string("checks"));
+
+    //deletepair erases a first chunk itself, teardown is called for the rest
+    auto pending = [&]() {
+      inspect();
+      delphioracle::teardownstable teardowns(contract_account, contract_account.value);
+      return teardowns.begin() != teardowns.end();
+    };
+
+    uint32_t calls = 0;
+    while (pending() && calls++ < 1000) call("teardown"_n, {c.oracles[0]}, &delphioracle::teardown, uint64_t(50));
+
+    expect(calls > 1, "the pair was too small to need several teardown calls");
+
+    inspect();
+
+    expect(native::scope_rows(contract_account, pair.value) == 0, "rows are left in the pair's scope");
+    expect(native::scope_rows(contract_account, default_pair.value) > 0, "the other pair's scope was emptied");
+
+    //rows of the pair in the contract's own scope, keyed by the pair
+    auto gone = [&](auto table, const std::string& what) {
+      expect(table.find(pair.value) == table.end(), "the pair's " + what + " row is left");
+    };
+
+    gone(delphioracle::pairstable(contract_account, contract_account.value), "pairs");
+    gone(delphioracle::pairstatetable(contract_account, contract_account.value), "pairstate");
+    gone(delphioracle::medianstable(contract_account, contract_account.value), "medians");
+    gone(delphioracle::windowstable(contract_account, contract_account.value), "windows");
+    gone(delphioracle::latesttable(contract_account, contract_account.value), "latest");
+    gone(delphioracle::twaptable(contract_account, contract_account.value), "twap");
+    gone(delphioracle::leaderboardtable(contract_account, contract_account.value), "leaderboard");
+    gone(delphioracle::rewardstable(contract_account, contract_account.value), "rewards");
+    gone(delphioracle::bountytallytable(contract_account, contract_account.value), "bountytally");
+    gone(delphioracle::teardownstable(contract_account, contract_account.value), "teardowns");
+
+    for (const auto& owner : c.oracles) {
+      gone(delphioracle::settlementstable(contract_account, owner.value), "settlements of " + owner.to_string());
+    }
+
+    delphioracle::approvalstable approvals(contract_account, contract_account.value);
+    for (const auto& a : approvals) expect(a.bounty != pair, "an approval of the pair is left");
+
+  }
+
+  //Cumulative of pair at the start of period, read the way consumer contracts do
+  bool checkpoint_at(name pair, uint64_t period, unsigned __int128& cumulative) {
+
+    inspect();
+
+    delphi::twap_state state;
+    if (!delphi::read_twap_state(contract_account, pair, state)) return false;
+
+    uint32_t at = uint32_t(period * delphi::twap_checkpoint_interval);
+
+    return delphi::read_cumulative(contract_account, state, at, cumulative) && at == period * delphi::twap_checkpoint_interval;
+
+  }
+
+  //TWAP between the starts of two periods, or 0 when a bound is not in the ring. used_from is the start
+  //of the range the average is over
+  uint64_t twap_between(name pair, uint64_t from, uint64_t to, uint32_t& used_from) {
+
+    inspect();
+
+    uint64_t average = 0;
+    uint32_t used_to;
+
+    if (!delphi::read_twap(contract_account, pair, uint32_t(from * delphi::twap_checkpoint_interval),
+                           uint32_t(to * delphi::twap_checkpoint_interval), average, used_from, used_to)) return 0;
+
+    return average;
+
+  }
+
+  uint64_t twap_between(name pair, uint64_t from, uint64_t to) {
+    uint32_t used_from;
+    return twap_between(pair, from, to, used_from);
+  }
+
+  void check_twapgap() {
+
+    const uint64_t interval = delphi::twap_checkpoint_interval;
+
+    chain c = setup(1, 1, 21);
+
+    const name owner = c.oracles[0];
+    const uint64_t start = time_point_sec(native::now()).sec_since_epoch() / interval;
+
+    auto write_at = [&](uint64_t at, uint64_t value) {
+      native::set_time(time_point(seconds(at)));
+      call("write"_n, {owner}, &delphioracle::write, owner, quote(value, default_pair));
+    };
+
+    //the first median counts from its write, then nothing is written for five periods
+    write_at(start * interval + 90, 1000);
+    write_at((start + 5) * interval + 100, 2000);
+
+    unsigned __int128 cumulative;
+
+    for (uint64_t p = start + 1; p <= start + 5; ++p) {
+      expect(checkpoint_at(default_pair, p, cumulative), "period " + std::to_string(p - start) + " has no checkpoint");
+    }
+
+    expect(checkpoint_at(default_pair, start + 1, cumulative) && cumulative == 1000 * (interval - 90),
+           "the first period is not counted from the first write");
+
+    uint32_t used_from = 0;
+
+    expect(twap_between(default_pair, start - 2, start + 5, used_from) == 1000, "TWAP over the gap is not the first median");
+    expect(used_from == start * interval + 90, "a range before the first write is not clamped to it");
+    expect(twap_between(default_pair, start - 2, start) == 0, "a range that ends before the first write is not empty");
+    expect(twap_between(default_pair, start + 2, start + 4) == 1000, "TWAP inside the gap is not the first median");
+
+    write_at((start + 5) * interval + 160, 3000);
+
+    auto view = call("gettwap"_n, {}, &delphioracle::gettwap, default_pair,
+                     time_point_sec((start + 5) * interval), time_point_sec((start + 5) * interval + 160));
+
+    expect(view.average == (1000 * 100 + 2000 * 60) / 160, "TWAP across the last write of the gap is off");
+
+    //a gap longer than the ring fills the ring's worth of periods before the next write
+    const uint64_t later = start + 5 + 3 * delphi::twap_ring_size;
+
+    write_at(later * interval + 30, 4000);
+
+    expect(twap_between(default_pair, later + 1 - delphi::twap_ring_size, later) == 3000, "TWAP over the ring after a long gap is off");
+    expect(!checkpoint_at(default_pair, later - delphi::twap_ring_size, cumulative), "a period older than the ring has a checkpoint");
+
+  }
+
+  void check_clear() {
+
+    const name pair = "btcusd"_n;
+
+    chain c = setup(2, 21, 21);
+
+    for (const auto& owner : c.oracles) call("write"_n, {owner}, &delphioracle::write, owner, quote(10000, default_pair));
+
+    add_pair(c, pair, 100000);
+
+    next_round();
+    for (const auto& owner : c.oracles) call("write"_n, {owner}, &delphioracle::write, owner, quote(20000, pair));
+
+    uint32_t calls = 0;
+    while (!call("clear"_n, {contract_account}, &delphioracle::clear, default_pair)) {
+      expect(++calls < 100, "clear does not finish");
+      if (calls >= 100) return;
+    }
+
+    inspect();
+
+    for (const auto& p : {default_pair, pair}) {
+      expect(native::scope_rows(contract_account, p.value) == 0, "clear left rows in the scope of " + p.to_string());
+    }
+
+    delphioracle::medianstable medians(contract_account, contract_account.value);
+    delphioracle::windowstable windows(contract_account, contract_account.value);
+    expect(medians.begin() == medians.end(), "clear left a medians row");
+    expect(windows.begin() == windows.end(), "clear left a windows row");
+
+    //both pairs get a fresh window, the default one through configure
+    call("configure"_n, {contract_account}, &delphioracle::configure, c.config);
+    propose_pair(c, pair, 100000);
+
+  }
+
+  //What voteabuser weighs for donator: the donors total and the rows it does not count yet
+  int64_t donated(name donator) {
+
+    inspect();
+
+    delphioracle::donorstable donors(contract_account, contract_account.value);
+    delphioracle::donationstable donations(contract_account, donator.value);
+
+    auto ditr = donors.find(donator.value);
+
+    int64_t total = ditr != donors.end() ? ditr->total.amount : 0;
+
+    for (const auto& d : donations) {
+      if (ditr == donors.end() || d.id < ditr->counted_from) total += d.amount.amount;
+    }
+
+    return total;
+
+  }
+
+  void check_compactdons() {
+
+    chain c = setup(2, 21, 21);
+
+    const name donator = c.donors[0];
+
+    //rows recorded before the donors total existed
+    inspect();
+    delphioracle::donationstable past(contract_account, donator.value);
+    for (uint64_t i = 0; i < 3; ++i) {
+      past.emplace(contract_account, [&](auto& d) {
+        d.id = i;
+        d.donator = donator;
+        d.pair = contract_account;
+        d.timestamp = native::now();
+        d.amount = eos(1000 * int64_t(i + 1));
+      });
+    }
+
+    transfer(donator, eos(7000), "");
+    transfer(donator, eos(9000), "");
+
+    expect(!try_transfer(donator, asset(5000, symbol("OTHER", 4)), ""), "a donation in another symbol was accepted");
+
+    const int64_t total = 1000 + 2000 + 3000 + 7000 + 9000;
+
+    expect(donated(donator) == total, "the donors total does not count every donation once");
+
+    expect(refused("compactdons"_n, {c.donors[1]}, &delphioracle::compactdons, donator, uint64_t(10)),
+           "compactdons ran for another donator's rows");
+
+    //only the past rows are folded, the recent ones are kept for the retention
+    call("compactdons"_n, {donator}, &delphioracle::compactdons, donator, uint64_t(10));
+
+    inspect();
+    delphioracle::donationstable recent(contract_account, donator.value);
+    expect(std::distance(recent.begin(), recent.end()) == 2, "compactdons did not stop at the recent rows");
+    expect(donated(donator) == total, "folding past rows changed the total");
+
+    native::advance_time(seconds(2592000 + 1));
+
+    call("compactdons"_n, {contract_account}, &delphioracle::compactdons, donator, uint64_t(10));
+
+    inspect();
+    delphioracle::donationstable left(contract_account, donator.value);
+    expect(left.begin() == left.end(), "compactdons left rows past the retention");
+    expect(donated(donator) == total, "erasing rows past the retention changed the total");
+
+  }
+
+  void check_migration() {
+
+    const name backup = "delphibackup"_n;
+    const std::vector<name> pairs{"btcusd"_n, "eoscad"_n};
+
+    chain c = setup(2, 21, 21);
+
+    //what the contract held before the upgrade, global is already configured here and is skipped
+    native::begin_action(backup, backup, "init"_n, {}, {backup});
+
+    delphioracle::oglobaltable bglobal(backup, backup.value);
+    bglobal.emplace(backup, [&](auto& g) {
+      g.id = 1;
+      g.total_datapoints_count = 1000;
+    });
+
+    auto seed_stats = [&](name scope, uint32_t count) {
+      delphioracle::statstable bstats(backup, scope.value);
+      for (uint32_t i = 0; i < count; ++i) {
+        bstats.emplace(backup, [&](auto& s) {
+          s.owner = synthetic_name("migrated", i);
+          s.timestamp = native::now();
+          s.count = 100 + i;
+          s.last_claim = NULL_TIME_POINT;
+          s.balance = eos(i);
+        });
+      }
+    };
+
+    seed_stats(backup, 7);
+
+    delphioracle::npairstable bpairs(backup, backup.value);
+
+    for (const auto& pair : pairs) {
+
+      bpairs.emplace(backup, [&](auto& p) {
+        p.active = true;
+        p.bounty_awarded = true;
+        p.proposer = c.donors[0];
+        p.name = pair;
+        p.quoted_precision = 4;
+      });
+
+      seed_stats(pair, 5);
+
+      delphioracle::datapointstable bpoints(backup, pair.value);
+      for (uint64_t i = 0; i < 21; ++i) {
+        bpoints.emplace(backup, [&](auto& d) {
+          d.id = i;
+          d.owner = synthetic_name("migrated", uint32_t(i % 5));
+          d.value = 10000 + i;
+          d.median = 10000;
+          d.timestamp = native::now();
+        });
+      }
+
+    }
+
+    const uint64_t rows = 7 + pairs.size() * (1 + 5 + 21);
+    const uint64_t batch = 10;
+
+    //copies start with the first call and each call resumes where the previous one stopped
+    uint64_t copied = 0;
+
+    for (uint32_t i = 0; i < 3; ++i) {
+      auto m = call("migratedata"_n, {contract_account}, &delphioracle::migratedata, binary_extension<uint64_t>(batch));
+      expect(m.copied > copied && m.copied - copied <= batch, "a migratedata call did not copy up to its batch");
+      expect(m.completed == NULL_TIME_POINT, "migratedata completed before every row was copied");
+      copied = m.copied;
+    }
+
+    auto m = call("migratedata"_n, {contract_account}, &delphioracle::migratedata, binary_extension<uint64_t>());
+
+    expect(m.completed != NULL_TIME_POINT, "migratedata without a batch did not finish the remaining rows");
+    expect(m.copied == rows, "migratedata copied " + std::to_string(m.copied) + " rows of " + std::to_string(rows));
+
+    inspect();
+
+    auto same_stats = [&](name from, name to) {
+      delphioracle::statstable source(backup, from.value);
+      delphioracle::statstable dest(contract_account, to.value);
+      for (const auto& s : source) {
+        auto itr = dest.find(s.owner.value);
+        expect(itr != dest.end() && itr->count == s.count && itr->balance == s.balance, "stats of " + s.owner.to_string() + " were not copied");
+      }
+    };
+
+    same_stats(backup, contract_account);
+
+    delphioracle::pairstable dpairs(contract_account, contract_account.value);
+
+    for (const auto& pair : pairs) {
+      expect(dpairs.find(pair.value) != dpairs.end(), pair.to_string() + " was not copied");
+      same_stats(pair, pair);
+      delphioracle::datapointstable source(backup, pair.value);
+      delphioracle::datapointstable dest(contract_account, pair.value);
+      for (const auto& d : source) {
+        auto itr = dest.find(d.id);
+        expect(itr != dest.end() && itr->value == d.value, "a datapoint of " + pair.to_string() + " was not copied");
+      }
+    }
+
+  }
+
+  void check_abuse() {
+
+    chain c = setup(3, 21, 21);
+
+    const name abuser = c.oracles[0];
+    const name voter = c.donors[0];
+
+    auto hash_of = [](const std::string& secret) {
+      return sha256(secret.c_str(), secret.size());
+    };
+
+    //one vote of the donor's proxied stake flags the oracle
+    call("setabuse"_n, {contract_account}, &delphioracle::setabuse, uint64_t(1000000));
+    call("voteabuser"_n, {voter}, &delphioracle::voteabuser, voter, abuser);
+
+    next_round();
+
+    expect(refused("writehash"_n, {abuser}, &delphioracle::writehash, abuser, hash_of("flagged"), std::string("")),
+           "writehash accepted a flagged oracle");
+    expect(refused("write"_n, {abuser}, &delphioracle::write, abuser, quote(10000, default_pair)),
+           "write accepted a flagged oracle");
+
+    call("writehash"_n, {c.oracles[1]}, &delphioracle::writehash, c.oracles[1], hash_of("other"), std::string(""));
+
+    call("unvoteabuser"_n, {voter}, &delphioracle::unvoteabuser, voter, abuser);
+
+    next_round();
+
+    call("writehash"_n, {abuser}, &delphioracle::writehash, abuser, hash_of("cleared"), std::string(""));
+    call("write"_n, {abuser}, &delphioracle::write, abuser, quote(10000, default_pair));
+
+  }
+
+  std::map<name, uint64_t> user_scores() {
+
+    inspect();
+
+    std::map<name, uint64_t> scores;
+
+    delphioracle::userstable users(contract_account, contract_account.value);
+    for (const auto& u : users) scores[u.name] = u.score;
+
+    return scores;
+
+  }
+
+  void check_sweep() {
+
+    chain c = setup(2, 21, 21);
+
+    //the donors proxy to the contract, the producers registered as users do not
+    for (const auto& d : c.donors) call("reguser"_n, {d}, &delphioracle::reguser, d);
+    for (uint32_t i = 0; i < 6; ++i) {
+      const name p = synthetic_name("producer", i);
+      call("reguser"_n, {p}, &delphioracle::reguser, p);
+    }
+
+    auto before = user_scores();
+
+    call("updateusers"_n, {contract_account}, &delphioracle::updateusers);
+
+    auto expected = user_scores();
+
+    //the same scores again, three users per call
+    const uint64_t batch = 3;
+    const uint64_t users = expected.size();
+
+    uint32_t calls = 0;
+    name cursor;
+
+    for (;;) {
+      auto state = call("sweepusers"_n, {contract_account}, &delphioracle::sweepusers, batch);
+      calls++;
+      if (!state.running) {
+        expect(state.updated == c.donors.size(), "the sweep did not count each proxying user once");
+        break;
+      }
+      expect(state.cursor.value > cursor.value, "the sweep cursor did not move forward");
+      cursor = state.cursor;
+      if (calls > users) break;
+    }
+
+    expect(calls == (users + batch - 1) / batch, "the sweep took " + std::to_string(calls) + " calls for " + std::to_string(users) + " users");
+
+    auto after = user_scores();
+
+    for (const auto& u : after) {
+      uint64_t swept = u.second - expected[u.first];
+      uint64_t updated = expected[u.first] - before[u.first];
+      expect(swept == updated, u.first.to_string() + " was swept other than updateusers updates it");
+    }
+
+  }
+
+  void check_derived() {
+
+    chain c = setup(2, 1, 21);
+
+    const name usd = default_pair;
+    const name btc = "btcusd"_n;
+    const name derived = "eosbtc"_n;
+
+    auto write_all = [&](name pair, uint64_t value) {
+      next_round();
+      for (const auto& owner : c.oracles) call("write"_n, {owner}, &delphioracle::write, owner, quote(value, pair));
+    };
+
+    write_all(usd, 52310);
+
+    const std::vector<delphioracle::derived_leg> legs{{usd, false}, {btc, true}};
+
+    propose_pair(c, btc, 100000);
+
+    expect(refused("setderived"_n, {contract_account}, &delphioracle::setderived, derived, legs, uint64_t(8)),
+           "a derived pair over a pair that is only proposed was accepted");
+
+    call("votebounty"_n, {custodian_account}, &delphioracle::votebounty, custodian_account, btc);
+    for (uint32_t v = 0; v < 2; ++v) call("votebounty"_n, {c.oracles[v]}, &delphioracle::votebounty, c.oracles[v], btc);
+
+    call("setderived"_n, {contract_account}, &delphioracle::setderived, derived, legs, uint64_t(8));
+
+    write_all(btc, 6734215000);
+
+    //EOS/BTC at 8 decimals from two rates at 4 decimals: usd * 10^8 / btc, truncated
+    const uint64_t expected = uint64_t((unsigned __int128)52310 * 100000000 / 6734215000);
+
+    auto view = call("getderived"_n, {}, &delphioracle::getderived, derived);
+
+    expect(view.median == expected, "getderived is not the cross rate of the legs");
+    expect(view.precision == 8, "getderived does not report the pair's precision");
+
+    inspect();
+
+    delphi::latest_price price;
+    expect(delphi::read_derived(contract_account, derived, price) && price.median == expected,
+           "read_derived is not the cross rate of the legs");
+
+    expect(refused("deletepair"_n, {contract_account}, &delphioracle::deletepair, btc, std::string("retired")),
+           "a leg of a derived pair was deleted");
+
+    call("delderived"_n, {contract_account}, &delphioracle::delderived, derived);
+    call("deletepair"_n, {contract_account}, &delphioracle::deletepair, btc, std::string("retired"));
+
+  }
+
+}
+
+int main(int argc, char** argv) {
+
+  const std::vector<std::pair<std::string, void (*)()>> scenarios{
+    {"hexchain", check_hexchain},
+    {"evenmedian", check_evenmedian},
+    {"rollup", check_rollup},
+    {"payouts", check_payouts},
+    {"teardown", check_teardown},
+    {"twapgap", check_twapgap},
+    {"clear", check_clear},
+    {"compactdons", check_compactdons},
+    {"migration", check_migration},
+    {"abuse", check_abuse},
+    {"sweep", check_sweep},
+    {"derived", check_derived}
+  };
+
+  if (argc == 2) {
+    for (const auto& s : scenarios) {
+      if (s.first != argv[1]) continue;
+      s.second();
+      if (failures > 0) return 1;
+      std::printf("%s: ok\n", argv[1]);
+      return 0;
+    }
+  }
+
+  std::fprintf(stderr, "usage: %s <scenario>, one of:", argv[0]);
+  for (const auto& s : scenarios) std::fprintf(stderr, " %s", s.first.c_str());
+  std::fprintf(stderr, "\n");
+
+  return 2;
+}
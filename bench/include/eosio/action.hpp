@@ -0,0 +1,120 @@
+/*
+
+  Native stand-in for <eosio/action.hpp>.
+
+  Inline actions are not executed; send() records them in the native
+  context so the benchmark can count them.
+
+*/
+
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native.hpp>
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+  struct permission_level {
+    permission_level(name a, name p) : actor(a), permission(p) {}
+    permission_level() {}
+
+    name actor;
+    name permission;
+
+    friend bool operator==(const permission_level& a, const permission_level& b) {
+      return a.actor == b.actor && a.permission == b.permission;
+    }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const permission_level& p) { return ds << p.actor << p.permission; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, permission_level& p) { return ds >> p.actor >> p.permission; }
+  };
+
+  template<typename T>
+  T unpack_action_data() {
+    const auto& data = native::current_action_data();
+    return unpack<T>(data.data(), data.size());
+  }
+
+  struct action {
+    eosio::name account;
+    eosio::name name;
+    std::vector<permission_level> authorization;
+    std::vector<char> data;
+
+    action() = default;
+
+    template<typename T>
+    action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+      : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+    template<typename T>
+    action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T&& value)
+      : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+    void send() const {
+      native::inline_action act{account, name, {}, data};
+      for (const auto& p : authorization) act.authorization.push_back(p.actor);
+      native::inline_actions().push_back(std::move(act));
+    }
+
+    void send_context_free() const { send(); }
+
+    template<typename T>
+    T data_as() const { return unpack<T>(data.data(), data.size()); }
+  };
+
+  namespace native {
+    template<typename T> struct action_args;
+    template<typename C, typename R, typename... Args>
+    struct action_args<R (C::*)(Args...)> {
+      using type = std::tuple<std::decay_t<Args>...>;
+    };
+    template<typename C, typename R, typename... Args>
+    struct action_args<R (C::*)(Args...) const> {
+      using type = std::tuple<std::decay_t<Args>...>;
+    };
+  }
+
+  template<name::raw Name, auto Action>
+  struct action_wrapper {
+    template<typename Code>
+    constexpr action_wrapper(Code&& code, std::vector<permission_level>&& perms)
+      : code_name(std::forward<Code>(code)), permissions(std::move(perms)) {}
+
+    template<typename Code>
+    constexpr action_wrapper(Code&& code, const std::vector<permission_level>& perms)
+      : code_name(std::forward<Code>(code)), permissions(perms) {}
+
+    template<typename Code>
+    constexpr action_wrapper(Code&& code, permission_level&& perm)
+      : code_name(std::forward<Code>(code)), permissions({1, std::move(perm)}) {}
+
+    template<typename Code>
+    constexpr action_wrapper(Code&& code, const permission_level& perm)
+      : code_name(std::forward<Code>(code)), permissions({1, perm}) {}
+
+    static constexpr eosio::name action_name = eosio::name(Name);
+    eosio::name code_name;
+    std::vector<permission_level> permissions;
+
+    template<typename... Args>
+    action to_action(Args&&... args) const {
+      typename native::action_args<decltype(Action)>::type data{std::forward<Args>(args)...};
+      return action(permissions, code_name, action_name, std::move(data));
+    }
+
+    template<typename... Args>
+    void send(Args&&... args) const {
+      to_action(std::forward<Args>(args)...).send();
+    }
+  };
+
+}
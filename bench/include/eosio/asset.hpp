@@ -0,0 +1,192 @@
+/*
+
+  Native stand-in for <eosio/symbol.hpp> and <eosio/asset.hpp>.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+  class symbol_code {
+  public:
+    constexpr symbol_code() : value(0) {}
+    constexpr explicit symbol_code(uint64_t raw) : value(raw) {}
+
+    constexpr explicit symbol_code(std::string_view str) : value(0) {
+      if (str.size() > 7) check(false, "string is too long to be a valid symbol_code");
+      for (auto itr = str.rbegin(); itr != str.rend(); ++itr) {
+        if (*itr < 'A' || *itr > 'Z') check(false, "only uppercase letters allowed in symbol_code string");
+        value <<= 8;
+        value |= *itr;
+      }
+    }
+
+    constexpr uint64_t raw() const { return value; }
+    constexpr bool is_valid() const { return value != 0; }
+
+    std::string to_string() const {
+      std::string s;
+      for (auto v = value; v; v >>= 8) s += char(v & 0xFF);
+      return s;
+    }
+
+    void print() const {
+      auto s = to_string();
+      internal_use_do_not_use::prints_l(s.c_str(), s.size());
+    }
+
+    friend constexpr bool operator==(const symbol_code& a, const symbol_code& b) { return a.value == b.value; }
+    friend constexpr bool operator!=(const symbol_code& a, const symbol_code& b) { return a.value != b.value; }
+    friend constexpr bool operator<(const symbol_code& a, const symbol_code& b) { return a.value < b.value; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const symbol_code& s) { return ds << s.value; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, symbol_code& s) { return ds >> s.value; }
+
+  private:
+    uint64_t value = 0;
+  };
+
+  class symbol {
+  public:
+    constexpr symbol() : value(0) {}
+    constexpr explicit symbol(uint64_t s) : value(s) {}
+    constexpr symbol(symbol_code sc, uint8_t precision) : value((sc.raw() << 8) | (uint64_t)precision) {}
+    constexpr symbol(std::string_view ss, uint8_t precision) : value((symbol_code(ss).raw() << 8) | (uint64_t)precision) {}
+
+    constexpr bool is_valid() const { return code().is_valid(); }
+    constexpr uint8_t precision() const { return value & 0xFFull; }
+    constexpr symbol_code code() const { return symbol_code{value >> 8}; }
+    constexpr uint64_t raw() const { return value; }
+    constexpr explicit operator bool() const { return value != 0; }
+
+    void print(bool show_precision = true) const {
+      if (show_precision) {
+        internal_use_do_not_use::printui(precision());
+        internal_use_do_not_use::prints(",");
+      }
+      code().print();
+    }
+
+    friend constexpr bool operator==(const symbol& a, const symbol& b) { return a.value == b.value; }
+    friend constexpr bool operator!=(const symbol& a, const symbol& b) { return a.value != b.value; }
+    friend constexpr bool operator<(const symbol& a, const symbol& b) { return a.value < b.value; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const symbol& s) { return ds << s.value; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, symbol& s) { return ds >> s.value; }
+
+  private:
+    uint64_t value = 0;
+  };
+
+  struct asset {
+    int64_t amount = 0;
+    eosio::symbol symbol;
+
+    static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+    asset() {}
+    asset(int64_t a, class symbol s) : amount(a), symbol{s} {
+      check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+      check(symbol.is_valid(), "invalid symbol name");
+    }
+
+    bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+    bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+    asset operator-() const {
+      asset r = *this;
+      r.amount = -r.amount;
+      return r;
+    }
+
+    asset& operator-=(const asset& a) {
+      check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+      amount -= a.amount;
+      check(-max_amount <= amount, "subtraction underflow");
+      check(amount <= max_amount, "subtraction overflow");
+      return *this;
+    }
+
+    asset& operator+=(const asset& a) {
+      check(a.symbol == symbol, "attempt to add asset with different symbol");
+      amount += a.amount;
+      check(-max_amount <= amount, "addition underflow");
+      check(amount <= max_amount, "addition overflow");
+      return *this;
+    }
+
+    friend asset operator+(const asset& a, const asset& b) {
+      asset result = a;
+      result += b;
+      return result;
+    }
+
+    friend asset operator-(const asset& a, const asset& b) {
+      asset result = a;
+      result -= b;
+      return result;
+    }
+
+    friend bool operator==(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount == b.amount;
+    }
+
+    friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+
+    friend bool operator<(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount < b.amount;
+    }
+
+    friend bool operator<=(const asset& a, const asset& b) { return !(b < a); }
+    friend bool operator>(const asset& a, const asset& b) { return b < a; }
+    friend bool operator>=(const asset& a, const asset& b) { return !(a < b); }
+
+    std::string to_string() const {
+      int64_t p = (int64_t)symbol.precision();
+      int64_t p10 = 1;
+      for (int64_t i = 0; i < p; ++i) p10 *= 10;
+
+      bool negative = amount < 0;
+      uint64_t abs_amount = negative ? uint64_t(-amount) : uint64_t(amount);
+      std::string result = std::to_string(abs_amount / p10);
+      if (p > 0) {
+        std::string fraction = std::to_string(abs_amount % p10);
+        result += "." + std::string(p - fraction.size(), '0') + fraction;
+      }
+      return (negative ? "-" : "") + result + " " + symbol.code().to_string();
+    }
+
+    void print() const {
+      auto s = to_string();
+      internal_use_do_not_use::prints_l(s.c_str(), s.size());
+    }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const asset& a) { return ds << a.amount << a.symbol; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, asset& a) { return ds >> a.amount >> a.symbol; }
+  };
+
+  struct extended_asset {
+    asset quantity;
+    name contract;
+  };
+
+}
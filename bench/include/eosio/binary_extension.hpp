@@ -0,0 +1,65 @@
+/*
+
+  Native stand-in for <eosio/binary_extension.hpp>.
+
+  An action argument or trailing row field that may be missing from the
+  serialized data: it is read only when bytes remain and written only
+  when it holds a value, the same wire format as eosio.cdt.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <optional>
+#include <utility>
+
+namespace eosio {
+
+  template<typename T>
+  class binary_extension {
+  public:
+    binary_extension() = default;
+    binary_extension(const T& v) : _value(v) {}
+    binary_extension(T&& v) : _value(std::move(v)) {}
+
+    bool has_value() const { return _value.has_value(); }
+    explicit operator bool() const { return has_value(); }
+
+    const T& value() const {
+      check(has_value(), "cannot get value of empty binary_extension");
+      return *_value;
+    }
+
+    T value_or(const T& def) const { return has_value() ? *_value : def; }
+
+    template<typename... Args>
+    binary_extension& emplace(Args&&... args) {
+      _value.emplace(std::forward<Args>(args)...);
+      return *this;
+    }
+
+    void reset() { _value.reset(); }
+
+  private:
+    std::optional<T> _value;
+  };
+
+  template<typename DataStream, typename T>
+  DataStream& operator<<(DataStream& ds, const binary_extension<T>& v) {
+    if (v.has_value()) ds << v.value();
+    return ds;
+  }
+
+  template<typename DataStream, typename T>
+  DataStream& operator>>(DataStream& ds, binary_extension<T>& v) {
+    if (ds.remaining() > 0) {
+      T value;
+      ds >> value;
+      v.emplace(std::move(value));
+    }
+    return ds;
+  }
+
+}
@@ -0,0 +1,42 @@
+/*
+
+  Native stand-in for <eosio/check.hpp>.
+
+  On chain a failed check aborts the transaction. On the host it throws
+  eosio::native::check_failure so the benchmark driver can report it.
+
+*/
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+  namespace native {
+
+    struct check_failure : std::runtime_error {
+      using std::runtime_error::runtime_error;
+    };
+
+  }
+
+  inline void check(bool pred, const char* msg) {
+    if (!pred) throw native::check_failure(msg);
+  }
+
+  inline void check(bool pred, const std::string& msg) {
+    if (!pred) throw native::check_failure(msg);
+  }
+
+  inline void check(bool pred, std::string_view msg) {
+    if (!pred) throw native::check_failure(std::string(msg));
+  }
+
+  inline void check(bool pred, uint64_t code) {
+    if (!pred) throw native::check_failure("assertion failure with error code: " + std::to_string(code));
+  }
+
+}
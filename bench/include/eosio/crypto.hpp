@@ -0,0 +1,86 @@
+/*
+
+  Native stand-in for <eosio/fixed_bytes.hpp> and <eosio/crypto.hpp>.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/print.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio {
+
+  template<std::size_t Size>
+  class fixed_bytes {
+  public:
+    fixed_bytes() { _data.fill(0); }
+    fixed_bytes(const std::array<uint8_t, Size>& arr) : _data(arr) {}
+
+    static constexpr std::size_t num_words() { return (Size + 15) / 16; }
+    static constexpr std::size_t size() { return Size; }
+
+    const uint8_t* data() const { return _data.data(); }
+    uint8_t* data() { return _data.data(); }
+
+    std::array<uint8_t, Size> extract_as_byte_array() const { return _data; }
+
+    void print() const { internal_use_do_not_use::printhex(_data.data(), Size); }
+
+    friend bool operator==(const fixed_bytes& a, const fixed_bytes& b) { return a._data == b._data; }
+    friend bool operator!=(const fixed_bytes& a, const fixed_bytes& b) { return a._data != b._data; }
+    friend bool operator<(const fixed_bytes& a, const fixed_bytes& b) { return a._data < b._data; }
+    friend bool operator>(const fixed_bytes& a, const fixed_bytes& b) { return a._data > b._data; }
+    friend bool operator<=(const fixed_bytes& a, const fixed_bytes& b) { return a._data <= b._data; }
+    friend bool operator>=(const fixed_bytes& a, const fixed_bytes& b) { return a._data >= b._data; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const fixed_bytes& d) {
+      ds.write((const char*)d._data.data(), Size);
+      return ds;
+    }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, fixed_bytes& d) {
+      ds.read((char*)d._data.data(), Size);
+      return ds;
+    }
+
+  private:
+    std::array<uint8_t, Size> _data;
+  };
+
+  using checksum160 = fixed_bytes<20>;
+  using checksum256 = fixed_bytes<32>;
+  using checksum512 = fixed_bytes<64>;
+
+  //only the K1/R1 layout is modelled; enough to round-trip eosio::producer_info rows
+  struct public_key {
+    uint8_t type = 0;
+    std::array<char, 33> data{};
+  };
+
+  struct signature {
+    uint8_t type = 0;
+    std::array<char, 65> data{};
+  };
+
+  namespace internal_use_do_not_use {
+    void sha256(const char* data, uint32_t length, uint8_t* hash);
+  }
+
+  inline checksum256 sha256(const char* data, uint32_t length) {
+    checksum256 hash;
+    internal_use_do_not_use::sha256(data, length, hash.data());
+    return hash;
+  }
+
+  inline void assert_sha256(const char* data, uint32_t length, const checksum256& hash) {
+    check(sha256(data, length) == hash, "hash mismatch");
+  }
+
+}
@@ -0,0 +1,326 @@
+/*
+
+  Native stand-in for <eosio/datastream.hpp> and <eosio/serialize.hpp>.
+
+  Produces the same wire format as eosio.cdt so that row sizes, RAM
+  billing and (de)serialization work measured on the host match what the
+  contract pays on chain.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/reflect.hpp>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace eosio {
+
+  template<typename T>
+  class datastream {
+  public:
+    datastream(T start, std::size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+    void skip(std::size_t s) { _pos += s; }
+
+    bool read(char* d, std::size_t s) {
+      check(std::size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+      std::memcpy(d, _pos, s);
+      _pos += s;
+      return true;
+    }
+
+    bool write(const char* d, std::size_t s) {
+      check(_end - _pos >= (int32_t)s, "datastream attempted to write past the end");
+      std::memcpy((void*)_pos, d, s);
+      _pos += s;
+      return true;
+    }
+
+    bool write(char c) { return write(&c, 1); }
+
+    T pos() const { return _pos; }
+    bool valid() const { return _pos <= _end && _pos >= _start; }
+    std::size_t tellp() const { return std::size_t(_pos - _start); }
+    std::size_t remaining() const { return std::size_t(_end - _pos); }
+
+  private:
+    T _start;
+    T _pos;
+    T _end;
+  };
+
+  template<>
+  class datastream<std::size_t> {
+  public:
+    datastream(std::size_t init_size = 0) : _size(init_size) {}
+
+    bool skip(std::size_t s) { _size += s; return true; }
+    bool write(const char*, std::size_t s) { _size += s; return true; }
+    bool write(char) { _size++; return true; }
+    std::size_t tellp() const { return _size; }
+
+  private:
+    std::size_t _size;
+  };
+
+  struct unsigned_int {
+    unsigned_int(uint32_t v = 0) : value(v) {}
+    operator uint32_t() const { return value; }
+    uint32_t value;
+  };
+
+  template<typename DataStream>
+  DataStream& operator<<(DataStream& ds, const unsigned_int& v) {
+    uint64_t val = v.value;
+    do {
+      uint8_t b = uint8_t(val) & 0x7f;
+      val >>= 7;
+      b |= ((val > 0) << 7);
+      ds.write((char)b);
+    } while (val);
+    return ds;
+  }
+
+  template<typename DataStream>
+  DataStream& operator>>(DataStream& ds, unsigned_int& vi) {
+    uint64_t v = 0;
+    char b = 0;
+    uint8_t by = 0;
+    do {
+      ds.read(&b, 1);
+      v |= uint32_t(uint8_t(b) & 0x7f) << by;
+      by += 7;
+    } while (uint8_t(b) & 0x80);
+    vi.value = static_cast<uint32_t>(v);
+    return ds;
+  }
+
+  namespace native {
+
+    template<typename T> struct is_std_array : std::false_type {};
+    template<typename T, std::size_t N> struct is_std_array<std::array<T, N>> : std::true_type {};
+
+    template<typename T, typename = void> struct has_serialize_list : std::false_type {};
+    template<typename T> struct has_serialize_list<T, std::void_t<typename T::eoslib_serialize_list>> : std::true_type {};
+
+    //plain TABLE/action structs serialize field by field, like pfr does in eosio.cdt
+    template<typename T>
+    constexpr bool is_reflected_v = std::is_class_v<T> && std::is_aggregate_v<T> &&
+                                    !is_std_array<T>::value && !has_serialize_list<T>::value;
+
+  }
+
+  template<typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>* = nullptr>
+  DataStream& operator<<(DataStream& ds, const T& v) {
+    ds.write((const char*)&v, sizeof(T));
+    return ds;
+  }
+
+  template<typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>* = nullptr>
+  DataStream& operator>>(DataStream& ds, T& v) {
+    ds.read((char*)&v, sizeof(T));
+    return ds;
+  }
+
+  template<typename DataStream>
+  DataStream& operator<<(DataStream& ds, const bool& v) {
+    return ds << uint8_t(v);
+  }
+
+  template<typename DataStream>
+  DataStream& operator>>(DataStream& ds, bool& v) {
+    uint8_t b;
+    ds >> b;
+    v = b;
+    return ds;
+  }
+
+  template<typename DataStream>
+  DataStream& operator<<(DataStream& ds, const std::string& v) {
+    ds << unsigned_int(v.size());
+    if (v.size()) ds.write(v.data(), v.size());
+    return ds;
+  }
+
+  template<typename DataStream>
+  DataStream& operator>>(DataStream& ds, std::string& v) {
+    unsigned_int s;
+    ds >> s;
+    v.resize(s.value);
+    if (s.value) ds.read(v.data(), s.value);
+    return ds;
+  }
+
+  template<typename DataStream, typename T>
+  DataStream& operator<<(DataStream& ds, const std::vector<T>& v) {
+    ds << unsigned_int(v.size());
+    for (const auto& i : v) ds << i;
+    return ds;
+  }
+
+  template<typename DataStream, typename T>
+  DataStream& operator>>(DataStream& ds, std::vector<T>& v) {
+    unsigned_int s;
+    ds >> s;
+    v.resize(s.value);
+    for (auto& i : v) ds >> i;
+    return ds;
+  }
+
+  template<typename DataStream, typename T, std::size_t N>
+  DataStream& operator<<(DataStream& ds, const std::array<T, N>& v) {
+    for (const auto& i : v) ds << i;
+    return ds;
+  }
+
+  template<typename DataStream, typename T, std::size_t N>
+  DataStream& operator>>(DataStream& ds, std::array<T, N>& v) {
+    for (auto& i : v) ds >> i;
+    return ds;
+  }
+
+  template<typename DataStream, typename A, typename B>
+  DataStream& operator<<(DataStream& ds, const std::pair<A, B>& v) {
+    return ds << v.first << v.second;
+  }
+
+  template<typename DataStream, typename A, typename B>
+  DataStream& operator>>(DataStream& ds, std::pair<A, B>& v) {
+    return ds >> v.first >> v.second;
+  }
+
+  template<typename DataStream, typename... Args>
+  DataStream& operator<<(DataStream& ds, const std::tuple<Args...>& v) {
+    std::apply([&](const auto&... e) { ((ds << e), ...); }, v);
+    return ds;
+  }
+
+  template<typename DataStream, typename... Args>
+  DataStream& operator>>(DataStream& ds, std::tuple<Args...>& v) {
+    std::apply([&](auto&... e) { ((ds >> e), ...); }, v);
+    return ds;
+  }
+
+  template<typename DataStream, typename T>
+  DataStream& operator<<(DataStream& ds, const std::optional<T>& v) {
+    ds << bool(v.has_value());
+    if (v) ds << *v;
+    return ds;
+  }
+
+  template<typename DataStream, typename T>
+  DataStream& operator>>(DataStream& ds, std::optional<T>& v) {
+    bool present;
+    ds >> present;
+    if (present) {
+      T t;
+      ds >> t;
+      v = std::move(t);
+    }
+    else v.reset();
+    return ds;
+  }
+
+  template<typename DataStream, typename K, typename V>
+  DataStream& operator<<(DataStream& ds, const std::map<K, V>& m) {
+    ds << unsigned_int(m.size());
+    for (const auto& kv : m) ds << kv.first << kv.second;
+    return ds;
+  }
+
+  template<typename DataStream, typename K, typename V>
+  DataStream& operator>>(DataStream& ds, std::map<K, V>& m) {
+    unsigned_int s;
+    ds >> s;
+    m.clear();
+    for (uint32_t i = 0; i < s.value; ++i) {
+      K k;
+      V v;
+      ds >> k >> v;
+      m.emplace(std::move(k), std::move(v));
+    }
+    return ds;
+  }
+
+  template<typename DataStream, typename... Ts>
+  DataStream& operator<<(DataStream& ds, const std::variant<Ts...>& v) {
+    ds << unsigned_int(v.index());
+    std::visit([&](const auto& e) { ds << e; }, v);
+    return ds;
+  }
+
+  template<typename DataStream, typename T, std::enable_if_t<native::is_reflected_v<T>>* = nullptr>
+  DataStream& operator<<(DataStream& ds, const T& v) {
+    native::reflect::for_each_field(v, [&](const auto& f) { ds << f; });
+    return ds;
+  }
+
+  template<typename DataStream, typename T, std::enable_if_t<native::is_reflected_v<T>>* = nullptr>
+  DataStream& operator>>(DataStream& ds, T& v) {
+    native::reflect::for_each_field(v, [&](auto& f) { ds >> f; });
+    return ds;
+  }
+
+  template<typename T>
+  std::size_t pack_size(const T& value) {
+    datastream<std::size_t> ps;
+    ps << value;
+    return ps.tellp();
+  }
+
+  template<typename T>
+  std::vector<char> pack(const T& value) {
+    std::vector<char> result;
+    result.resize(pack_size(value));
+    datastream<char*> ds(result.data(), result.size());
+    ds << value;
+    return result;
+  }
+
+  template<typename T>
+  T unpack(const char* buffer, std::size_t len) {
+    T result;
+    datastream<const char*> ds(buffer, len);
+    ds >> result;
+    return result;
+  }
+
+  template<typename T>
+  T unpack(const std::vector<char>& bytes) {
+    return unpack<T>(bytes.data(), bytes.size());
+  }
+
+}
+
+#define EOSLIB_REFLECT_OUT_A(m) << t.m EOSLIB_REFLECT_OUT_B
+#define EOSLIB_REFLECT_OUT_B(m) << t.m EOSLIB_REFLECT_OUT_A
+#define EOSLIB_REFLECT_OUT_A_END
+#define EOSLIB_REFLECT_OUT_B_END
+#define EOSLIB_REFLECT_IN_A(m) >> t.m EOSLIB_REFLECT_IN_B
+#define EOSLIB_REFLECT_IN_B(m) >> t.m EOSLIB_REFLECT_IN_A
+#define EOSLIB_REFLECT_IN_A_END
+#define EOSLIB_REFLECT_IN_B_END
+#define EOSLIB_REFLECT_CAT(a, b) EOSLIB_REFLECT_CAT_I(a, b)
+#define EOSLIB_REFLECT_CAT_I(a, b) a ## b
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS) \
+  using eoslib_serialize_list = void; \
+  template<typename DataStream> \
+  friend DataStream& operator<<(DataStream& ds, const TYPE& t) { \
+    return ds EOSLIB_REFLECT_CAT(EOSLIB_REFLECT_OUT_A MEMBERS, _END); \
+  } \
+  template<typename DataStream> \
+  friend DataStream& operator>>(DataStream& ds, TYPE& t) { \
+    return ds EOSLIB_REFLECT_CAT(EOSLIB_REFLECT_IN_A MEMBERS, _END); \
+  }
@@ -0,0 +1,24 @@
+/*
+
+  Native stand-in for the eosio.cdt database intrinsics.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace eosio { namespace internal_use_do_not_use {
+
+  int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void* data, uint32_t len);
+  void db_update_i64(int32_t iterator, uint64_t payer, const void* data, uint32_t len);
+  void db_remove_i64(int32_t iterator);
+  int32_t db_get_i64(int32_t iterator, const void* data, uint32_t len);
+  int32_t db_next_i64(int32_t iterator, uint64_t* primary);
+  int32_t db_previous_i64(int32_t iterator, uint64_t* primary);
+  int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+  int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+  int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+  int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table);
+
+}}
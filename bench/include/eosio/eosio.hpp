@@ -0,0 +1,23 @@
+/*
+
+  Native stand-in for <eosio/eosio.hpp>.
+
+  Lets src/delphioracle.cpp compile as ordinary host code so its actions
+  can be driven and measured by bench/delphioracle_bench.cpp. Only the
+  parts of eosio.cdt the contract uses are provided.
+
+*/
+
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+#include <eosio/system.hpp>
+#include <eosio/time.hpp>
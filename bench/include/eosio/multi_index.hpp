@@ -0,0 +1,736 @@
+/*
+
+  Native stand-in for <eosio/multi_index.hpp>.
+
+  Follows the eosio.cdt implementation closely (object cache per table
+  instance, lazily resolved secondary iterators, secondary keys only
+  rewritten when they change) so that the number and kind of db_* calls
+  made by the contract are the same as on chain.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/db.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+namespace eosio {
+
+  namespace _multi_index_detail {
+
+    template<typename T>
+    struct secondary_key_traits {
+      static constexpr T true_lowest() { return std::numeric_limits<T>::lowest(); }
+    };
+
+    template<>
+    struct secondary_key_traits<uint128_t> {
+      static constexpr uint128_t true_lowest() { return 0; }
+    };
+
+    template<>
+    struct secondary_key_traits<checksum256> {
+      static checksum256 true_lowest() { return checksum256(); }
+    };
+
+    template<typename K>
+    struct secondary_index_db_functions {
+      static native::secondary_db<K>& db() { return native::secondary_db<K>::instance(); }
+
+      static int32_t db_idx_next(int32_t iterator, uint64_t* primary) { return db().next(iterator, *primary); }
+      static int32_t db_idx_previous(int32_t iterator, uint64_t* primary) { return db().previous(iterator, *primary); }
+      static void db_idx_remove(int32_t iterator) { db().remove(iterator); }
+      static int32_t db_idx_end(uint64_t code, uint64_t scope, uint64_t table) { return db().end(code, scope, table); }
+      static int32_t db_idx_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const K& secondary) {
+        return db().store(scope, table, payer, id, secondary);
+      }
+      static void db_idx_update(int32_t iterator, uint64_t payer, const K& secondary) { db().update(iterator, payer, secondary); }
+      static int32_t db_idx_find_primary(uint64_t code, uint64_t scope, uint64_t table, uint64_t primary, K& secondary) {
+        return db().find_primary(code, scope, table, secondary, primary);
+      }
+      static int32_t db_idx_find_secondary(uint64_t code, uint64_t scope, uint64_t table, const K& secondary, uint64_t& primary) {
+        return db().find_secondary(code, scope, table, secondary, primary);
+      }
+      static int32_t db_idx_lowerbound(uint64_t code, uint64_t scope, uint64_t table, K& secondary, uint64_t& primary) {
+        return db().lowerbound(code, scope, table, secondary, primary);
+      }
+      static int32_t db_idx_upperbound(uint64_t code, uint64_t scope, uint64_t table, K& secondary, uint64_t& primary) {
+        return db().upperbound(code, scope, table, secondary, primary);
+      }
+    };
+
+  }
+
+  //a modify billed to same_payer keeps the payer the row already has
+  constexpr static inline name same_payer{};
+
+  template<name::raw IndexName, typename Extractor>
+  struct indexed_by {
+    static constexpr name::raw index_name = IndexName;
+    typedef Extractor secondary_extractor_type;
+  };
+
+  template<class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+  struct const_mem_fun {
+    typedef typename std::remove_reference<Type>::type result_type;
+
+    Type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+  };
+
+  template<name::raw TableName, typename T, typename... Indices>
+  class multi_index {
+  private:
+
+    static_assert(sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices");
+
+    constexpr static bool validate_table_name(name::raw n) {
+      return (static_cast<uint64_t>(n) & 0x000000000000000FULL) == 0;
+    }
+
+    static_assert(validate_table_name(TableName), "multi_index does not support table names with a length greater than 12");
+
+    name _code;
+    uint64_t _scope;
+
+    mutable uint64_t _next_primary_key;
+
+    enum next_primary_key_tags : uint64_t {
+      no_available_primary_key = static_cast<uint64_t>(-2),
+      unset_next_primary_key = static_cast<uint64_t>(-1)
+    };
+
+    struct item : public T {
+      template<typename Constructor>
+      item(const multi_index* idx, Constructor&& c) : __idx(idx) {
+        c(*this);
+      }
+
+      const multi_index* __idx;
+      int32_t __primary_itr;
+      mutable int32_t __iters[sizeof...(Indices) + (sizeof...(Indices) == 0)];
+    };
+
+    struct item_ptr {
+      item_ptr(std::unique_ptr<item>&& i, uint64_t pk, int32_t pitr)
+        : _item(std::move(i)), _primary_key(pk), _primary_itr(pitr) {}
+
+      std::unique_ptr<item> _item;
+      uint64_t _primary_key;
+      int32_t _primary_itr;
+    };
+
+    mutable std::vector<item_ptr> _items_vector;
+
+    template<name::raw IndexName, typename Extractor, uint64_t Number, bool IsConst>
+    struct index {
+    public:
+      typedef Extractor secondary_extractor_type;
+      typedef std::decay_t<decltype(Extractor()(std::declval<const T&>()))> secondary_key_type;
+      typedef _multi_index_detail::secondary_index_db_functions<secondary_key_type> db_functions;
+
+      constexpr static bool validate_index_name(eosio::name n) {
+        return n.value != 0 && !(n.value & 0x000000000000000FULL);
+      }
+
+      static_assert(validate_index_name(eosio::name(IndexName)), "invalid index name used in multi_index");
+
+      static constexpr uint64_t index_table_name() {
+        return (static_cast<uint64_t>(TableName) & 0xFFFFFFFFFFFFFFF0ULL) | (Number & 0x000000000000000FULL);
+      }
+
+      static constexpr uint64_t number() { return Number; }
+
+      struct const_iterator {
+      public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = const T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+        const T& operator*() const { return *static_cast<const T*>(_item); }
+        const T* operator->() const { return static_cast<const T*>(_item); }
+
+        const_iterator operator++(int) {
+          const_iterator result(*this);
+          ++(*this);
+          return result;
+        }
+
+        const_iterator operator--(int) {
+          const_iterator result(*this);
+          --(*this);
+          return result;
+        }
+
+        const_iterator& operator++() {
+          using namespace _multi_index_detail;
+          eosio::check(_item != nullptr, "cannot increment end iterator");
+
+          if (_item->__iters[Number] == -1) {
+            secondary_key_type temp_secondary_key;
+            auto idxitr = db_functions::db_idx_find_primary(_idx->get_code().value, _idx->get_scope(), _idx->name(),
+                                                            _item->primary_key(), temp_secondary_key);
+            _item->__iters[Number] = idxitr;
+          }
+
+          uint64_t next_pk = 0;
+          auto next_itr = db_functions::db_idx_next(_item->__iters[Number], &next_pk);
+          if (next_itr < 0) {
+            _item = nullptr;
+            return *this;
+          }
+
+          const T& obj = *_idx->_multidx->find(next_pk);
+          auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+          mi.__iters[Number] = next_itr;
+          _item = &mi;
+
+          return *this;
+        }
+
+        const_iterator& operator--() {
+          using namespace _multi_index_detail;
+          uint64_t prev_pk = 0;
+          int32_t prev_itr = -1;
+
+          if (!_item) {
+            auto ei = db_functions::db_idx_end(_idx->get_code().value, _idx->get_scope(), _idx->name());
+            eosio::check(ei != -1, "cannot decrement end iterator when the index is empty");
+            prev_itr = db_functions::db_idx_previous(ei, &prev_pk);
+            eosio::check(prev_itr >= 0, "cannot decrement end iterator when the index is empty");
+          }
+          else {
+            if (_item->__iters[Number] == -1) {
+              secondary_key_type temp_secondary_key;
+              auto idxitr = db_functions::db_idx_find_primary(_idx->get_code().value, _idx->get_scope(), _idx->name(),
+                                                              _item->primary_key(), temp_secondary_key);
+              _item->__iters[Number] = idxitr;
+            }
+            prev_itr = db_functions::db_idx_previous(_item->__iters[Number], &prev_pk);
+            eosio::check(prev_itr >= 0, "cannot decrement iterator at beginning of index");
+          }
+
+          const T& obj = *_idx->_multidx->find(prev_pk);
+          auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+          mi.__iters[Number] = prev_itr;
+          _item = &mi;
+
+          return *this;
+        }
+
+        const_iterator() : _idx(nullptr), _item(nullptr) {}
+
+      private:
+        friend struct index;
+
+        const_iterator(const index* idx, const item* i = nullptr) : _idx(idx), _item(i) {}
+
+        const index* _idx;
+        const item* _item;
+      };
+
+      typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+      const_iterator cbegin() const {
+        using namespace _multi_index_detail;
+        return lower_bound(secondary_key_traits<secondary_key_type>::true_lowest());
+      }
+      const_iterator begin() const { return cbegin(); }
+
+      const_iterator cend() const { return const_iterator(this); }
+      const_iterator end() const { return cend(); }
+
+      const_reverse_iterator crbegin() const { return std::make_reverse_iterator(cend()); }
+      const_reverse_iterator rbegin() const { return crbegin(); }
+
+      const_reverse_iterator crend() const { return std::make_reverse_iterator(cbegin()); }
+      const_reverse_iterator rend() const { return crend(); }
+
+      const_iterator find(secondary_key_type&& secondary) const {
+        auto lb = lower_bound(secondary);
+        auto e = cend();
+        if (lb == e) return e;
+
+        if (!(secondary == secondary_extractor_type()(*lb))) return e;
+        return lb;
+      }
+
+      const_iterator find(const secondary_key_type& secondary) const {
+        auto lb = lower_bound(secondary);
+        auto e = cend();
+        if (lb == e) return e;
+
+        if (!(secondary == secondary_extractor_type()(*lb))) return e;
+        return lb;
+      }
+
+      const_iterator require_find(const secondary_key_type& secondary, const char* error_msg = "unable to find secondary key") const {
+        auto lb = lower_bound(secondary);
+        eosio::check(lb != cend(), error_msg);
+        eosio::check(secondary == secondary_extractor_type()(*lb), error_msg);
+        return lb;
+      }
+
+      const T& get(const secondary_key_type& secondary, const char* error_msg = "unable to find secondary key") const {
+        auto result = find(secondary);
+        eosio::check(result != cend(), error_msg);
+        return *result;
+      }
+
+      const_iterator lower_bound(const secondary_key_type& secondary) const {
+        using namespace _multi_index_detail;
+        uint64_t primary = 0;
+        secondary_key_type secondary_copy(secondary);
+        auto itr = db_functions::db_idx_lowerbound(get_code().value, get_scope(), name(), secondary_copy, primary);
+        if (itr < 0) return cend();
+
+        const T& obj = *_multidx->find(primary);
+        auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+        mi.__iters[Number] = itr;
+
+        return {this, &mi};
+      }
+
+      const_iterator upper_bound(const secondary_key_type& secondary) const {
+        using namespace _multi_index_detail;
+        uint64_t primary = 0;
+        secondary_key_type secondary_copy(secondary);
+        auto itr = db_functions::db_idx_upperbound(get_code().value, get_scope(), name(), secondary_copy, primary);
+        if (itr < 0) return cend();
+
+        const T& obj = *_multidx->find(primary);
+        auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+        mi.__iters[Number] = itr;
+
+        return {this, &mi};
+      }
+
+      const_iterator iterator_to(const T& obj) {
+        using namespace _multi_index_detail;
+        const auto& objitem = static_cast<const item&>(obj);
+        eosio::check(objitem.__idx == _multidx, "object passed to iterator_to is not in multi_index");
+
+        if (objitem.__iters[Number] == -1) {
+          secondary_key_type temp_secondary_key;
+          auto idxitr = db_functions::db_idx_find_primary(get_code().value, get_scope(), name(), objitem.primary_key(), temp_secondary_key);
+          auto& mi = const_cast<item&>(objitem);
+          mi.__iters[Number] = idxitr;
+        }
+
+        return {this, &objitem};
+      }
+
+      template<typename Lambda>
+      void modify(const_iterator itr, eosio::name payer, Lambda&& updater) {
+        eosio::check(itr != cend(), "cannot pass end iterator to modify");
+        _multidx->modify(*itr, payer, std::forward<Lambda&&>(updater));
+      }
+
+      const_iterator erase(const_iterator itr) {
+        eosio::check(itr != cend(), "cannot pass end iterator to erase");
+
+        const auto& obj = *itr;
+        ++itr;
+
+        _multidx->erase(obj);
+
+        return itr;
+      }
+
+      eosio::name get_code() const { return _multidx->get_code(); }
+      uint64_t get_scope() const { return _multidx->get_scope(); }
+      uint64_t name() const { return index_table_name(); }
+
+      static auto extract_secondary_key(const T& obj) { return secondary_extractor_type()(obj); }
+
+    private:
+      friend class multi_index;
+
+      index(typename std::conditional<IsConst, const multi_index*, multi_index*>::type midx) : _multidx(midx) {}
+
+      typename std::conditional<IsConst, const multi_index*, multi_index*>::type _multidx;
+    };
+
+    template<std::size_t... Is>
+    static auto make_indices(std::index_sequence<Is...>)
+      -> std::tuple<index<Indices::index_name, typename Indices::secondary_extractor_type, Is, false>...>;
+
+    typedef decltype(make_indices(std::index_sequence_for<Indices...>{})) indices_type;
+
+    template<std::size_t I = 0, typename F>
+    static void for_each_index(F&& f) {
+      if constexpr (I < sizeof...(Indices)) {
+        f(static_cast<std::tuple_element_t<I, indices_type>*>(nullptr));
+        for_each_index<I + 1>(std::forward<F>(f));
+      }
+    }
+
+    template<name::raw IndexName>
+    static constexpr std::size_t index_position() {
+      constexpr uint64_t names[] = {static_cast<uint64_t>(Indices::index_name)..., 0};
+      for (std::size_t i = 0; i < sizeof...(Indices); ++i) {
+        if (names[i] == static_cast<uint64_t>(IndexName)) return i;
+      }
+      return sizeof...(Indices);
+    }
+
+    const item& load_object_by_primary_iterator(int32_t itr) const {
+      using namespace _multi_index_detail;
+
+      auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                               [&](const item_ptr& ptr) { return ptr._primary_itr == itr; });
+      if (itr2 != _items_vector.rend()) return *itr2->_item;
+
+      auto size = internal_use_do_not_use::db_get_i64(itr, nullptr, 0);
+      eosio::check(size >= 0, "error reading iterator");
+
+      std::vector<char> buffer(size);
+      internal_use_do_not_use::db_get_i64(itr, buffer.data(), uint32_t(size));
+
+      datastream<const char*> ds(buffer.data(), uint32_t(size));
+
+      auto ptr = std::make_unique<item>(this, [&](auto& i) {
+        T& val = static_cast<T&>(i);
+        ds >> val;
+
+        i.__primary_itr = itr;
+        for (auto& it : i.__iters) it = -1;
+      });
+
+      const item* ptr2 = ptr.get();
+
+      _items_vector.emplace_back(std::move(ptr), ptr2->primary_key(), itr);
+
+      return *ptr2;
+    }
+
+  public:
+
+    multi_index(name code, uint64_t scope)
+      : _code(code), _scope(scope), _next_primary_key(unset_next_primary_key) {}
+
+    name get_code() const { return _code; }
+    uint64_t get_scope() const { return _scope; }
+
+    struct const_iterator {
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = const T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const T*;
+      using reference = const T&;
+
+      friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+      friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+      const T& operator*() const { return *static_cast<const T*>(_item); }
+      const T* operator->() const { return static_cast<const T*>(_item); }
+
+      const_iterator operator++(int) {
+        const_iterator result(*this);
+        ++(*this);
+        return result;
+      }
+
+      const_iterator operator--(int) {
+        const_iterator result(*this);
+        --(*this);
+        return result;
+      }
+
+      const_iterator& operator++() {
+        eosio::check(_item != nullptr, "cannot increment end iterator");
+
+        uint64_t next_pk;
+        auto next_itr = internal_use_do_not_use::db_next_i64(_item->__primary_itr, &next_pk);
+        if (next_itr < 0) _item = nullptr;
+        else _item = &_multidx->load_object_by_primary_iterator(next_itr);
+        return *this;
+      }
+
+      const_iterator& operator--() {
+        uint64_t prev_pk;
+        int32_t prev_itr = -1;
+
+        if (!_item) {
+          auto ei = internal_use_do_not_use::db_end_i64(_multidx->get_code().value, _multidx->get_scope(), static_cast<uint64_t>(TableName));
+          eosio::check(ei != -1, "cannot decrement end iterator when the table is empty");
+          prev_itr = internal_use_do_not_use::db_previous_i64(ei, &prev_pk);
+          eosio::check(prev_itr >= 0, "cannot decrement end iterator when the table is empty");
+        }
+        else {
+          prev_itr = internal_use_do_not_use::db_previous_i64(_item->__primary_itr, &prev_pk);
+          eosio::check(prev_itr >= 0, "cannot decrement iterator at beginning of table");
+        }
+
+        _item = &_multidx->load_object_by_primary_iterator(prev_itr);
+        return *this;
+      }
+
+      const_iterator() : _multidx(nullptr), _item(nullptr) {}
+
+    private:
+      const_iterator(const multi_index* mi, const item* i = nullptr) : _multidx(mi), _item(i) {}
+
+      const multi_index* _multidx;
+      const item* _item;
+      friend class multi_index;
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    const_iterator cbegin() const { return lower_bound(std::numeric_limits<uint64_t>::lowest()); }
+    const_iterator begin() const { return cbegin(); }
+
+    const_iterator cend() const { return const_iterator(this); }
+    const_iterator end() const { return cend(); }
+
+    const_reverse_iterator crbegin() const { return std::make_reverse_iterator(cend()); }
+    const_reverse_iterator rbegin() const { return crbegin(); }
+
+    const_reverse_iterator crend() const { return std::make_reverse_iterator(cbegin()); }
+    const_reverse_iterator rend() const { return crend(); }
+
+    const_iterator lower_bound(uint64_t primary) const {
+      auto itr = internal_use_do_not_use::db_lowerbound_i64(_code.value, _scope, static_cast<uint64_t>(TableName), primary);
+      if (itr < 0) return end();
+      const auto& obj = load_object_by_primary_iterator(itr);
+      return {this, &obj};
+    }
+
+    const_iterator upper_bound(uint64_t primary) const {
+      auto itr = internal_use_do_not_use::db_upperbound_i64(_code.value, _scope, static_cast<uint64_t>(TableName), primary);
+      if (itr < 0) return end();
+      const auto& obj = load_object_by_primary_iterator(itr);
+      return {this, &obj};
+    }
+
+    uint64_t available_primary_key() const {
+      if (_next_primary_key == unset_next_primary_key) {
+        if (begin() == end()) {
+          _next_primary_key = 0;
+        }
+        else {
+          auto itr = --end();
+          auto pk = itr->primary_key();
+          if (pk >= no_available_primary_key) _next_primary_key = no_available_primary_key;
+          else _next_primary_key = pk + 1;
+        }
+      }
+
+      eosio::check(_next_primary_key < no_available_primary_key, "next primary key in table is at autoincrement limit");
+      return _next_primary_key;
+    }
+
+    template<name::raw IndexName>
+    auto get_index() {
+      constexpr std::size_t pos = index_position<IndexName>();
+      static_assert(pos < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+      typedef std::tuple_element_t<pos, indices_type> index_type;
+      return index_type(this);
+    }
+
+    template<name::raw IndexName>
+    auto get_index() const {
+      constexpr std::size_t pos = index_position<IndexName>();
+      static_assert(pos < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+      typedef std::tuple_element_t<pos, indices_type> mutable_index_type;
+      typedef index<IndexName, typename mutable_index_type::secondary_extractor_type, mutable_index_type::number(), true> index_type;
+      return index_type(this);
+    }
+
+    const_iterator iterator_to(const T& obj) const {
+      const auto& objitem = static_cast<const item&>(obj);
+      eosio::check(objitem.__idx == this, "object passed to iterator_to is not in multi_index");
+      return {this, &objitem};
+    }
+
+    template<typename Lambda>
+    const_iterator emplace(name payer, Lambda&& constructor) {
+      using namespace _multi_index_detail;
+
+      eosio::check(_code == native::current_receiver(), "cannot create objects in table of another contract");
+
+      auto i = std::make_unique<item>(this, [&](auto& i) {
+        T& obj = static_cast<T&>(i);
+        constructor(obj);
+
+        std::vector<char> buffer(pack_size(obj));
+        datastream<char*> ds(buffer.data(), buffer.size());
+        ds << obj;
+
+        auto pk = obj.primary_key();
+
+        i.__primary_itr = internal_use_do_not_use::db_store_i64(_scope, static_cast<uint64_t>(TableName), payer.value, pk, buffer.data(), buffer.size());
+
+        if (pk >= _next_primary_key) _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+
+        for_each_index([&](auto* idx) {
+          typedef std::remove_pointer_t<decltype(idx)> index_type;
+          i.__iters[index_type::number()] = index_type::db_functions::db_idx_store(_scope, index_type::index_table_name(), payer.value, pk,
+                                                                                   index_type::extract_secondary_key(obj));
+        });
+      });
+
+      const item* ptr = i.get();
+      auto pk = ptr->primary_key();
+      auto pitr = ptr->__primary_itr;
+
+      _items_vector.emplace_back(std::move(i), pk, pitr);
+
+      return {this, ptr};
+    }
+
+    template<typename Lambda>
+    void modify(const_iterator itr, name payer, Lambda&& updater) {
+      eosio::check(itr != end(), "cannot pass end iterator to modify");
+
+      modify(*itr, payer, std::forward<Lambda&&>(updater));
+    }
+
+    template<typename Lambda>
+    void modify(const T& obj, name payer, Lambda&& updater) {
+      using namespace _multi_index_detail;
+
+      const auto& objitem = static_cast<const item&>(obj);
+      eosio::check(objitem.__idx == this, "object passed to modify is not in multi_index");
+      auto& mutableitem = const_cast<item&>(objitem);
+      eosio::check(_code == native::current_receiver(), "cannot modify objects in table of another contract");
+
+      auto secondary_keys = std::apply([&](auto*... idx) {
+        return std::make_tuple(std::remove_pointer_t<decltype(idx)>::extract_secondary_key(obj)...);
+      }, indices_type_pointers());
+
+      uint64_t pk = mutableitem.primary_key();
+
+      updater(static_cast<T&>(mutableitem));
+
+      eosio::check(pk == mutableitem.primary_key(), "updater cannot change primary key when modifying an object");
+
+      std::vector<char> buffer(pack_size(obj));
+      datastream<char*> ds(buffer.data(), buffer.size());
+      ds << obj;
+
+      internal_use_do_not_use::db_update_i64(objitem.__primary_itr, payer.value, buffer.data(), buffer.size());
+
+      if (pk >= _next_primary_key) _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+
+      for_each_index([&](auto* idx) {
+        typedef std::remove_pointer_t<decltype(idx)> index_type;
+        auto secondary = index_type::extract_secondary_key(obj);
+        if (!(std::get<index_type::number()>(secondary_keys) == secondary)) {
+          auto indexitr = mutableitem.__iters[index_type::number()];
+
+          if (indexitr < 0) {
+            typename index_type::secondary_key_type temp_secondary_key;
+            indexitr = mutableitem.__iters[index_type::number()] =
+              index_type::db_functions::db_idx_find_primary(_code.value, _scope, index_type::index_table_name(), pk, temp_secondary_key);
+          }
+
+          index_type::db_functions::db_idx_update(indexitr, payer.value, secondary);
+        }
+      });
+    }
+
+    const T& get(uint64_t primary, const char* error_msg = "unable to find key") const {
+      auto result = find(primary);
+      eosio::check(result != cend(), error_msg);
+      return *result;
+    }
+
+    const_iterator find(uint64_t primary) const {
+      auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                               [&](const item_ptr& ptr) { return ptr._item->primary_key() == primary; });
+      if (itr2 != _items_vector.rend()) return iterator_to(*(itr2->_item));
+
+      auto itr = internal_use_do_not_use::db_find_i64(_code.value, _scope, static_cast<uint64_t>(TableName), primary);
+      if (itr < 0) return end();
+
+      const item& i = load_object_by_primary_iterator(itr);
+      return iterator_to(static_cast<const T&>(i));
+    }
+
+    const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const {
+      auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                               [&](const item_ptr& ptr) { return ptr._item->primary_key() == primary; });
+      if (itr2 != _items_vector.rend()) return iterator_to(*(itr2->_item));
+
+      auto itr = internal_use_do_not_use::db_find_i64(_code.value, _scope, static_cast<uint64_t>(TableName), primary);
+      eosio::check(itr >= 0, error_msg);
+
+      const item& i = load_object_by_primary_iterator(itr);
+      return iterator_to(static_cast<const T&>(i));
+    }
+
+    const_iterator erase(const_iterator itr) {
+      eosio::check(itr != end(), "cannot pass end iterator to erase");
+
+      const auto& obj = *itr;
+      ++itr;
+
+      erase(obj);
+
+      return itr;
+    }
+
+    void erase(const T& obj) {
+      using namespace _multi_index_detail;
+
+      const auto& objitem = static_cast<const item&>(obj);
+      eosio::check(objitem.__idx == this, "object passed to erase is not in multi_index");
+      eosio::check(_code == native::current_receiver(), "cannot erase objects in table of another contract");
+
+      auto pk = objitem.primary_key();
+      internal_use_do_not_use::db_remove_i64(objitem.__primary_itr);
+
+      for_each_index([&](auto* idx) {
+        typedef std::remove_pointer_t<decltype(idx)> index_type;
+        auto i = objitem.__iters[index_type::number()];
+        if (i < 0) {
+          typename index_type::secondary_key_type secondary;
+          i = index_type::db_functions::db_idx_find_primary(_code.value, _scope, index_type::index_table_name(), pk, secondary);
+        }
+        if (i >= 0) index_type::db_functions::db_idx_remove(i);
+      });
+
+      auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                               [&](const item_ptr& ptr) { return ptr._item.get() == &objitem; });
+
+      eosio::check(itr2 != _items_vector.rend(), "attempt to remove object that was not in multi_index");
+
+      _items_vector.erase(--(itr2.base()));
+    }
+
+  private:
+
+    template<std::size_t... Is>
+    static auto indices_type_pointers_impl(std::index_sequence<Is...>) {
+      return std::make_tuple(static_cast<std::tuple_element_t<Is, indices_type>*>(nullptr)...);
+    }
+
+    static auto indices_type_pointers() {
+      return indices_type_pointers_impl(std::index_sequence_for<Indices...>{});
+    }
+  };
+
+}
@@ -0,0 +1,314 @@
+/*
+
+  Host-side chain state backing the eosio stand-in headers.
+
+  Holds the in-memory database behind the db_* intrinsics, the per-action
+  context (receiver, authorizations, action data, console, inline actions),
+  the controllable block clock and the counters the benchmark reports:
+  primary/secondary database calls, bytes moved through db_get/db_store and
+  RAM billed per payer using nodeos' billable row sizes.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio { namespace native {
+
+  //Billable sizes from chain/contract_table_objects.hpp
+  constexpr int64_t table_overhead_bytes = 108;
+  constexpr int64_t primary_row_overhead_bytes = 108;
+
+  template<typename K> constexpr int64_t secondary_row_overhead_bytes = 96 + 24 + sizeof(K);
+  template<> constexpr int64_t secondary_row_overhead_bytes<checksum256> = 96 + 24 + 32;
+
+  struct db_counters {
+    uint64_t reads = 0;         //db_find/get/next/previous/lowerbound/upperbound/end_i64
+    uint64_t writes = 0;        //db_store/update/remove_i64
+    uint64_t idx_reads = 0;     //db_idx*_find/lowerbound/upperbound/end/next/previous
+    uint64_t idx_writes = 0;    //db_idx*_store/update/remove
+    uint64_t bytes_read = 0;    //row bytes returned by db_get_i64
+    uint64_t bytes_written = 0; //row bytes passed to db_store/update_i64
+
+    db_counters& operator+=(const db_counters& o) {
+      reads += o.reads; writes += o.writes; idx_reads += o.idx_reads; idx_writes += o.idx_writes;
+      bytes_read += o.bytes_read; bytes_written += o.bytes_written;
+      return *this;
+    }
+
+    friend db_counters operator-(db_counters a, const db_counters& b) {
+      a.reads -= b.reads; a.writes -= b.writes; a.idx_reads -= b.idx_reads; a.idx_writes -= b.idx_writes;
+      a.bytes_read -= b.bytes_read; a.bytes_written -= b.bytes_written;
+      return a;
+    }
+  };
+
+  struct inline_action {
+    name account;
+    name action;
+    std::vector<name> authorization;
+    std::vector<char> data;
+  };
+
+  db_counters& counters();
+
+  void charge_ram(uint64_t payer, int64_t delta);
+  int64_t ram_usage(name payer);
+  std::map<uint64_t, int64_t>& ram_usages();
+
+  name current_receiver();
+  name current_first_receiver();
+  name current_action();
+  const std::vector<char>& current_action_data();
+  bool has_authorization(name n);
+
+  //Sets up a fresh action context, as nodeos does for every apply()
+  void begin_action(name receiver, name first_receiver, name act, std::vector<char> data, std::vector<name> auths);
+
+  //Switches the receiver without touching the rest of the context (used to seed other contracts' tables)
+  void set_receiver(name receiver);
+
+  time_point now();
+  void set_time(time_point t);
+  void advance_time(microseconds m);
+
+  std::string& console();
+  std::vector<inline_action>& inline_actions();
+  std::vector<char>& action_return_value();
+
+  //Number of rows in a primary table, for reporting
+  std::size_t table_rows(name code, uint64_t scope, name table);
+
+  //Sum of the serialized row sizes in a primary table
+  std::size_t table_bytes(name code, uint64_t scope, name table);
+
+  //Number of rows in every primary table of code under scope
+  std::size_t scope_rows(name code, uint64_t scope);
+
+  void register_cache_reset(std::function<void()> f);
+
+  struct table_key {
+    uint64_t code;
+    uint64_t scope;
+    uint64_t table;
+
+    friend bool operator<(const table_key& a, const table_key& b) {
+      return std::tie(a.code, a.scope, a.table) < std::tie(b.code, b.scope, b.table);
+    }
+  };
+
+  //Secondary index storage for one key type, with the same iterator
+  //semantics as nodeos (end iterators are -(table_index + 2), -1 means
+  //the index table does not exist).
+  template<typename K>
+  class secondary_db {
+  public:
+
+    static secondary_db& instance() {
+      static secondary_db db;
+      return db;
+    }
+
+    int32_t store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const K& secondary) {
+      counters().idx_writes++;
+      table_key key{current_receiver().value, scope, table};
+      auto& t = _tables[key];
+      t.table = key;
+      if (t.rows.empty()) {
+        t.payer = payer;
+        charge_ram(payer, table_overhead_bytes);
+      }
+      check(t.rows.find(id) == t.rows.end(), "secondary index already has a row with this primary key");
+      t.rows[id] = {secondary, payer};
+      t.entries.insert({secondary, id});
+      charge_ram(payer, secondary_row_overhead_bytes<K>);
+      return cache(&t, id);
+    }
+
+    void update(int32_t iterator, uint64_t payer, const K& secondary) {
+      counters().idx_writes++;
+      auto& it = get_iterator(iterator);
+      check(it.t->table.code == current_receiver().value, "db access violation");
+      auto& row = it.t->rows[it.pk];
+      it.t->entries.erase({row.first, it.pk});
+      it.t->entries.insert({secondary, it.pk});
+      if (payer == 0) payer = row.second;
+      if (row.second != payer) {
+        charge_ram(row.second, -secondary_row_overhead_bytes<K>);
+        charge_ram(payer, secondary_row_overhead_bytes<K>);
+      }
+      row = {secondary, payer};
+    }
+
+    void remove(int32_t iterator) {
+      counters().idx_writes++;
+      auto& it = get_iterator(iterator);
+      check(it.t->table.code == current_receiver().value, "db access violation");
+      auto row = it.t->rows[it.pk];
+      it.t->entries.erase({row.first, it.pk});
+      it.t->rows.erase(it.pk);
+      charge_ram(row.second, -secondary_row_overhead_bytes<K>);
+      if (it.t->rows.empty()) charge_ram(it.t->payer, -table_overhead_bytes);
+      _index.erase({it.t, it.pk});
+      it.t = nullptr;
+    }
+
+    int32_t find_secondary(uint64_t code, uint64_t scope, uint64_t table, const K& secondary, uint64_t& primary) {
+      counters().idx_reads++;
+      auto* t = find_table(code, scope, table);
+      if (!t) return -1;
+      auto itr = t->entries.lower_bound({secondary, 0});
+      if (itr == t->entries.end() || !(itr->first == secondary)) return end_iterator(t);
+      primary = itr->second;
+      return cache(t, itr->second);
+    }
+
+    int32_t find_primary(uint64_t code, uint64_t scope, uint64_t table, K& secondary, uint64_t primary) {
+      counters().idx_reads++;
+      auto* t = find_table(code, scope, table);
+      if (!t) return -1;
+      auto itr = t->rows.find(primary);
+      if (itr == t->rows.end()) return end_iterator(t);
+      secondary = itr->second.first;
+      return cache(t, primary);
+    }
+
+    int32_t lowerbound(uint64_t code, uint64_t scope, uint64_t table, K& secondary, uint64_t& primary) {
+      counters().idx_reads++;
+      auto* t = find_table(code, scope, table);
+      if (!t) return -1;
+      auto itr = t->entries.lower_bound({secondary, 0});
+      if (itr == t->entries.end()) return end_iterator(t);
+      secondary = itr->first;
+      primary = itr->second;
+      return cache(t, itr->second);
+    }
+
+    int32_t upperbound(uint64_t code, uint64_t scope, uint64_t table, K& secondary, uint64_t& primary) {
+      counters().idx_reads++;
+      auto* t = find_table(code, scope, table);
+      if (!t) return -1;
+      auto itr = t->entries.upper_bound({secondary, std::numeric_limits<uint64_t>::max()});
+      if (itr == t->entries.end()) return end_iterator(t);
+      secondary = itr->first;
+      primary = itr->second;
+      return cache(t, itr->second);
+    }
+
+    int32_t end(uint64_t code, uint64_t scope, uint64_t table) {
+      counters().idx_reads++;
+      auto* t = find_table(code, scope, table);
+      if (!t) return -1;
+      return end_iterator(t);
+    }
+
+    int32_t next(int32_t iterator, uint64_t& primary) {
+      counters().idx_reads++;
+      if (iterator < -1) return -1;
+      auto& it = get_iterator(iterator);
+      auto itr = it.t->entries.find({it.t->rows[it.pk].first, it.pk});
+      ++itr;
+      if (itr == it.t->entries.end()) return end_iterator(it.t);
+      primary = itr->second;
+      return cache(it.t, itr->second);
+    }
+
+    int32_t previous(int32_t iterator, uint64_t& primary) {
+      counters().idx_reads++;
+      if (iterator < -1) {
+        auto* t = _ends.at(-(iterator + 2));
+        if (t->entries.empty()) return -1;
+        auto itr = std::prev(t->entries.end());
+        primary = itr->second;
+        return cache(t, itr->second);
+      }
+      auto& it = get_iterator(iterator);
+      auto itr = it.t->entries.find({it.t->rows[it.pk].first, it.pk});
+      if (itr == it.t->entries.begin()) return -1;
+      --itr;
+      primary = itr->second;
+      return cache(it.t, itr->second);
+    }
+
+  private:
+
+    struct entry_less {
+      bool operator()(const std::pair<K, uint64_t>& a, const std::pair<K, uint64_t>& b) const {
+        if (a.first < b.first) return true;
+        if (b.first < a.first) return false;
+        return a.second < b.second;
+      }
+    };
+
+    struct table {
+      table_key table;
+      uint64_t payer = 0;
+      std::set<std::pair<K, uint64_t>, entry_less> entries;
+      std::map<uint64_t, std::pair<K, uint64_t>> rows; //primary -> (secondary, payer)
+    };
+
+    struct iterator_state {
+      table* t;
+      uint64_t pk;
+    };
+
+    secondary_db() {
+      register_cache_reset([this]() {
+        _iterators.clear();
+        _index.clear();
+        _ends.clear();
+      });
+    }
+
+    table* find_table(uint64_t code, uint64_t scope, uint64_t tbl) {
+      auto itr = _tables.find(table_key{code, scope, tbl});
+      if (itr == _tables.end() || itr->second.rows.empty()) return nullptr;
+      itr->second.table = itr->first;
+      return &itr->second;
+    }
+
+    int32_t end_iterator(table* t) {
+      for (std::size_t i = 0; i < _ends.size(); ++i) {
+        if (_ends[i] == t) return -int32_t(i) - 2;
+      }
+      _ends.push_back(t);
+      return -int32_t(_ends.size()) - 1;
+    }
+
+    int32_t cache(table* t, uint64_t pk) {
+      auto itr = _index.find({t, pk});
+      if (itr != _index.end()) return itr->second;
+      _iterators.push_back({t, pk});
+      int32_t i = int32_t(_iterators.size()) - 1;
+      _index[{t, pk}] = i;
+      return i;
+    }
+
+    iterator_state& get_iterator(int32_t iterator) {
+      check(iterator >= 0 && std::size_t(iterator) < _iterators.size(), "invalid secondary index iterator");
+      auto& it = _iterators[iterator];
+      check(it.t != nullptr, "dereference of deleted secondary index object");
+      return it;
+    }
+
+    std::map<table_key, table> _tables;
+    std::vector<iterator_state> _iterators;
+    std::map<std::pair<table*, uint64_t>, int32_t> _index;
+    std::vector<table*> _ends;
+  };
+
+}}
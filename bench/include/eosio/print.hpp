@@ -0,0 +1,60 @@
+/*
+
+  Native stand-in for <eosio/print.hpp>.
+
+  Output is appended to the action console buffer (see native.hpp), the
+  same way nodeos collects it, so formatting costs show up in timings.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace eosio {
+
+  namespace internal_use_do_not_use {
+    void prints(const char* cstr);
+    void prints_l(const char* cstr, uint32_t len);
+    void printi(int64_t value);
+    void printui(uint64_t value);
+    void printdf(double value);
+    void printn(uint64_t name);
+    void printhex(const void* data, uint32_t datalen);
+  }
+
+  inline void printhex(const void* ptr, uint32_t size) {
+    internal_use_do_not_use::printhex(ptr, size);
+  }
+
+  namespace native {
+    template<typename T, typename = void> struct has_print : std::false_type {};
+    template<typename T> struct has_print<T, std::void_t<decltype(std::declval<const T&>().print())>> : std::true_type {};
+  }
+
+  template<typename T>
+  void print(T&& t) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) internal_use_do_not_use::prints(t);
+    else if constexpr (std::is_same_v<U, std::string>) internal_use_do_not_use::prints_l(t.c_str(), t.size());
+    else if constexpr (std::is_same_v<U, bool>) internal_use_do_not_use::prints(t ? "true" : "false");
+    else if constexpr (std::is_same_v<U, char>) internal_use_do_not_use::prints_l(&t, 1);
+    else if constexpr (std::is_floating_point_v<U>) internal_use_do_not_use::printdf(t);
+    else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) internal_use_do_not_use::printi(t);
+    else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) internal_use_do_not_use::printui(uint64_t(t));
+    else {
+      static_assert(native::has_print<U>::value, "type is not printable");
+      t.print();
+    }
+  }
+
+  template<typename Arg, typename... Args>
+  void print(Arg&& a, Args&&... args) {
+    print(std::forward<Arg>(a));
+    print(std::forward<Args>(args)...);
+  }
+
+}
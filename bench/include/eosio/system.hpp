@@ -0,0 +1,42 @@
+/*
+
+  Native stand-in for <eosio/system.hpp>.
+
+*/
+
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+  inline time_point current_time_point() {
+    return native::now();
+  }
+
+  inline time_point_sec current_time_point_sec() {
+    return time_point_sec(current_time_point());
+  }
+
+  inline void require_auth(name n) {
+    check(native::has_authorization(n), "missing authority of " + n.to_string());
+  }
+
+  inline bool has_auth(name n) {
+    return native::has_authorization(n);
+  }
+
+  inline bool is_account(name n) {
+    return n.value != 0;
+  }
+
+  inline name current_receiver() {
+    return native::current_receiver();
+  }
+
+  inline void require_recipient(name) {}
+
+}
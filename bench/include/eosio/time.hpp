@@ -0,0 +1,108 @@
+/*
+
+  Native stand-in for <eosio/time.hpp>.
+
+*/
+
+#pragma once
+
+#include <eosio/print.hpp>
+
+#include <cstdint>
+
+namespace eosio {
+
+  class microseconds {
+  public:
+    explicit constexpr microseconds(int64_t c = 0) : _count(c) {}
+
+    static constexpr microseconds maximum() { return microseconds(0x7fffffffffffffffll); }
+
+    friend constexpr microseconds operator+(const microseconds& l, const microseconds& r) { return microseconds(l._count + r._count); }
+    friend constexpr microseconds operator-(const microseconds& l, const microseconds& r) { return microseconds(l._count - r._count); }
+
+    constexpr bool operator==(const microseconds& c) const { return _count == c._count; }
+    constexpr bool operator!=(const microseconds& c) const { return _count != c._count; }
+    constexpr bool operator>(const microseconds& c) const { return _count > c._count; }
+    constexpr bool operator>=(const microseconds& c) const { return _count >= c._count; }
+    constexpr bool operator<(const microseconds& c) const { return _count < c._count; }
+    constexpr bool operator<=(const microseconds& c) const { return _count <= c._count; }
+
+    microseconds& operator+=(const microseconds& c) { _count += c._count; return *this; }
+    microseconds& operator-=(const microseconds& c) { _count -= c._count; return *this; }
+
+    constexpr int64_t count() const { return _count; }
+    constexpr int64_t to_seconds() const { return _count / 1000000; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const microseconds& m) { return ds << m._count; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, microseconds& m) { return ds >> m._count; }
+
+    int64_t _count;
+  };
+
+  inline constexpr microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+  inline constexpr microseconds milliseconds(int64_t s) { return microseconds(s * 1000); }
+  inline constexpr microseconds minutes(int64_t m) { return seconds(60 * m); }
+  inline constexpr microseconds hours(int64_t h) { return minutes(60 * h); }
+  inline constexpr microseconds days(int64_t d) { return hours(24 * d); }
+
+  class time_point {
+  public:
+    explicit constexpr time_point(microseconds e = microseconds()) : elapsed(e) {}
+
+    constexpr const microseconds& time_since_epoch() const { return elapsed; }
+    constexpr uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+
+    constexpr bool operator>(const time_point& t) const { return elapsed._count > t.elapsed._count; }
+    constexpr bool operator>=(const time_point& t) const { return elapsed._count >= t.elapsed._count; }
+    constexpr bool operator<(const time_point& t) const { return elapsed._count < t.elapsed._count; }
+    constexpr bool operator<=(const time_point& t) const { return elapsed._count <= t.elapsed._count; }
+    constexpr bool operator==(const time_point& t) const { return elapsed._count == t.elapsed._count; }
+    constexpr bool operator!=(const time_point& t) const { return elapsed._count != t.elapsed._count; }
+
+    time_point& operator+=(const microseconds& m) { elapsed += m; return *this; }
+    time_point& operator-=(const microseconds& m) { elapsed -= m; return *this; }
+    constexpr time_point operator+(const microseconds& m) const { return time_point(elapsed + m); }
+    constexpr time_point operator-(const microseconds& m) const { return time_point(elapsed - m); }
+    constexpr microseconds operator-(const time_point& m) const { return microseconds(elapsed.count() - m.elapsed.count()); }
+
+    void print() const { internal_use_do_not_use::printi(elapsed.count()); }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const time_point& t) { return ds << t.elapsed; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, time_point& t) { return ds >> t.elapsed; }
+
+    microseconds elapsed;
+  };
+
+  class time_point_sec {
+  public:
+    constexpr time_point_sec() : utc_seconds(0) {}
+    constexpr explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+    constexpr time_point_sec(const time_point& t) : utc_seconds(uint32_t(t.time_since_epoch().count() / 1000000ll)) {}
+
+    constexpr operator time_point() const { return time_point(eosio::seconds(utc_seconds)); }
+    constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+
+    constexpr bool operator==(const time_point_sec& t) const { return utc_seconds == t.utc_seconds; }
+    constexpr bool operator!=(const time_point_sec& t) const { return utc_seconds != t.utc_seconds; }
+    constexpr bool operator<(const time_point_sec& t) const { return utc_seconds < t.utc_seconds; }
+    constexpr bool operator>(const time_point_sec& t) const { return utc_seconds > t.utc_seconds; }
+    constexpr bool operator<=(const time_point_sec& t) const { return utc_seconds <= t.utc_seconds; }
+    constexpr bool operator>=(const time_point_sec& t) const { return utc_seconds >= t.utc_seconds; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const time_point_sec& t) { return ds << t.utc_seconds; }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, time_point_sec& t) { return ds >> t.utc_seconds; }
+
+    uint32_t utc_seconds;
+  };
+
+}
@@ -0,0 +1,40 @@
+/*
+
+  Native stand-in for <eosio/transaction.hpp>.
+
+  Deferred transactions are not scheduled; send() records their actions
+  with the inline actions so the benchmark can count them.
+
+*/
+
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace eosio {
+
+  struct transaction {
+    transaction() = default;
+    explicit transaction(time_point_sec exp) : expiration(exp) {}
+
+    time_point_sec expiration;
+    uint16_t ref_block_num = 0;
+    uint32_t ref_block_prefix = 0;
+    uint32_t delay_sec = 0;
+    std::vector<action> context_free_actions;
+    std::vector<action> actions;
+
+    void send(const unsigned __int128& sender_id, name payer, bool replace_existing = false) const {
+      (void)sender_id; (void)payer; (void)replace_existing;
+      for (const auto& a : actions) a.send();
+    }
+  };
+
+  inline void cancel_deferred(const unsigned __int128& sender_id) { (void)sender_id; }
+
+}
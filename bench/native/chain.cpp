@@ -0,0 +1,394 @@
+/*
+
+  Host implementation of the db_* / print intrinsics and the action
+  context declared in bench/include/eosio/native.hpp.
+
+*/
+
+#include <eosio/db.hpp>
+#include <eosio/native.hpp>
+#include <eosio/print.hpp>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+namespace eosio { namespace native {
+
+  namespace {
+
+    struct row {
+      std::vector<char> data;
+      uint64_t payer;
+    };
+
+    struct table {
+      table_key key;
+      uint64_t payer = 0;
+      std::map<uint64_t, row> rows;
+    };
+
+    struct iterator_state {
+      table* t;
+      uint64_t pk;
+    };
+
+    struct context {
+      name receiver;
+      name first_receiver;
+      name action;
+      std::vector<char> data;
+      std::vector<name> auths;
+      time_point now;
+      std::string console;
+      std::vector<inline_action> inline_actions;
+      std::vector<char> return_value;
+    };
+
+    std::map<table_key, table>& tables() {
+      static std::map<table_key, table> t;
+      return t;
+    }
+
+    std::vector<iterator_state>& iterators() {
+      static std::vector<iterator_state> i;
+      return i;
+    }
+
+    std::map<std::pair<table*, uint64_t>, int32_t>& iterator_index() {
+      static std::map<std::pair<table*, uint64_t>, int32_t> i;
+      return i;
+    }
+
+    std::vector<table*>& end_iterators() {
+      static std::vector<table*> e;
+      return e;
+    }
+
+    std::vector<std::function<void()>>& cache_resets() {
+      static std::vector<std::function<void()>> r;
+      return r;
+    }
+
+    context& ctx() {
+      static context c;
+      return c;
+    }
+
+    table* find_table(uint64_t code, uint64_t scope, uint64_t tbl) {
+      auto itr = tables().find(table_key{code, scope, tbl});
+      if (itr == tables().end() || itr->second.rows.empty()) return nullptr;
+      return &itr->second;
+    }
+
+    int32_t end_iterator(table* t) {
+      auto& ends = end_iterators();
+      for (std::size_t i = 0; i < ends.size(); ++i) {
+        if (ends[i] == t) return -int32_t(i) - 2;
+      }
+      ends.push_back(t);
+      return -int32_t(ends.size()) - 1;
+    }
+
+    int32_t cache(table* t, uint64_t pk) {
+      auto& index = iterator_index();
+      auto itr = index.find({t, pk});
+      if (itr != index.end()) return itr->second;
+      iterators().push_back({t, pk});
+      int32_t i = int32_t(iterators().size()) - 1;
+      index[{t, pk}] = i;
+      return i;
+    }
+
+    iterator_state& get_iterator(int32_t iterator) {
+      check(iterator >= 0 && std::size_t(iterator) < iterators().size(), "invalid iterator");
+      auto& it = iterators()[iterator];
+      check(it.t != nullptr, "dereference of deleted object");
+      return it;
+    }
+
+    void print_raw(const char* s, std::size_t len) {
+      ctx().console.append(s, len);
+    }
+
+  }
+
+  db_counters& counters() {
+    static db_counters c;
+    return c;
+  }
+
+  std::map<uint64_t, int64_t>& ram_usages() {
+    static std::map<uint64_t, int64_t> r;
+    return r;
+  }
+
+  void charge_ram(uint64_t payer, int64_t delta) {
+    ram_usages()[payer] += delta;
+  }
+
+  int64_t ram_usage(name payer) {
+    auto itr = ram_usages().find(payer.value);
+    return itr == ram_usages().end() ? 0 : itr->second;
+  }
+
+  name current_receiver() { return ctx().receiver; }
+  name current_first_receiver() { return ctx().first_receiver; }
+  name current_action() { return ctx().action; }
+  const std::vector<char>& current_action_data() { return ctx().data; }
+
+  bool has_authorization(name n) {
+    for (const auto& a : ctx().auths) {
+      if (a == n) return true;
+    }
+    return false;
+  }
+
+  void begin_action(name receiver, name first_receiver, name act, std::vector<char> data, std::vector<name> auths) {
+    auto& c = ctx();
+    c.receiver = receiver;
+    c.first_receiver = first_receiver;
+    c.action = act;
+    c.data = std::move(data);
+    c.auths = std::move(auths);
+    c.console.clear();
+    c.inline_actions.clear();
+    c.return_value.clear();
+
+    iterators().clear();
+    iterator_index().clear();
+    end_iterators().clear();
+    for (auto& f : cache_resets()) f();
+  }
+
+  void set_receiver(name receiver) { ctx().receiver = receiver; }
+
+  time_point now() { return ctx().now; }
+  void set_time(time_point t) { ctx().now = t; }
+  void advance_time(microseconds m) { ctx().now += m; }
+
+  std::string& console() { return ctx().console; }
+  std::vector<inline_action>& inline_actions() { return ctx().inline_actions; }
+  std::vector<char>& action_return_value() { return ctx().return_value; }
+
+  std::size_t table_rows(name code, uint64_t scope, name tbl) {
+    auto* t = find_table(code.value, scope, tbl.value);
+    return t ? t->rows.size() : 0;
+  }
+
+  std::size_t table_bytes(name code, uint64_t scope, name tbl) {
+    auto* t = find_table(code.value, scope, tbl.value);
+    std::size_t total = 0;
+    if (t) {
+      for (const auto& r : t->rows) total += r.second.data.size();
+    }
+    return total;
+  }
+
+  std::size_t scope_rows(name code, uint64_t scope) {
+    std::size_t total = 0;
+    for (const auto& t : tables()) {
+      if (t.first.code == code.value && t.first.scope == scope) total += t.second.rows.size();
+    }
+    return total;
+  }
+
+  void register_cache_reset(std::function<void()> f) {
+    cache_resets().push_back(std::move(f));
+  }
+
+}}
+
+namespace eosio { namespace internal_use_do_not_use {
+
+  using namespace eosio::native;
+
+  int32_t db_store_i64(uint64_t scope, uint64_t tbl, uint64_t payer, uint64_t id, const void* data, uint32_t len) {
+    counters().writes++;
+    counters().bytes_written += len;
+
+    table_key key{current_receiver().value, scope, tbl};
+    auto& t = tables()[key];
+    t.key = key;
+    if (t.rows.empty()) {
+      t.payer = payer;
+      charge_ram(payer, table_overhead_bytes);
+    }
+
+    check(t.rows.find(id) == t.rows.end(), "db_store_i64: a row with this primary key already exists");
+
+    auto& r = t.rows[id];
+    r.data.assign((const char*)data, (const char*)data + len);
+    r.payer = payer;
+    charge_ram(payer, primary_row_overhead_bytes + len);
+
+    return cache(&t, id);
+  }
+
+  void db_update_i64(int32_t iterator, uint64_t payer, const void* data, uint32_t len) {
+    counters().writes++;
+    counters().bytes_written += len;
+
+    auto& it = get_iterator(iterator);
+    check(it.t->key.code == current_receiver().value, "db access violation");
+
+    auto& r = it.t->rows[it.pk];
+    if (payer == 0) payer = r.payer;
+    if (r.payer == payer) {
+      charge_ram(payer, int64_t(len) - int64_t(r.data.size()));
+    }
+    else {
+      charge_ram(r.payer, -(primary_row_overhead_bytes + int64_t(r.data.size())));
+      charge_ram(payer, primary_row_overhead_bytes + len);
+    }
+
+    r.data.assign((const char*)data, (const char*)data + len);
+    r.payer = payer;
+  }
+
+  void db_remove_i64(int32_t iterator) {
+    counters().writes++;
+
+    auto& it = get_iterator(iterator);
+    check(it.t->key.code == current_receiver().value, "db access violation");
+
+    auto r = it.t->rows.find(it.pk);
+    charge_ram(r->second.payer, -(primary_row_overhead_bytes + int64_t(r->second.data.size())));
+    it.t->rows.erase(r);
+    if (it.t->rows.empty()) charge_ram(it.t->payer, -table_overhead_bytes);
+
+    iterator_index().erase({it.t, it.pk});
+    it.t = nullptr;
+  }
+
+  int32_t db_get_i64(int32_t iterator, const void* data, uint32_t len) {
+    counters().reads++;
+
+    auto& it = get_iterator(iterator);
+    const auto& r = it.t->rows.at(it.pk);
+    auto s = uint32_t(r.data.size());
+    if (len == 0) return s;
+
+    auto copy_size = std::min(len, s);
+    std::memcpy((void*)data, r.data.data(), copy_size);
+    counters().bytes_read += copy_size;
+    return copy_size;
+  }
+
+  int32_t db_next_i64(int32_t iterator, uint64_t* primary) {
+    counters().reads++;
+    if (iterator < -1) return -1;
+
+    auto& it = get_iterator(iterator);
+    auto itr = it.t->rows.upper_bound(it.pk);
+    if (itr == it.t->rows.end()) return end_iterator(it.t);
+
+    *primary = itr->first;
+    return cache(it.t, itr->first);
+  }
+
+  int32_t db_previous_i64(int32_t iterator, uint64_t* primary) {
+    counters().reads++;
+
+    if (iterator < -1) {
+      auto* t = end_iterators().at(-(iterator + 2));
+      if (t->rows.empty()) return -1;
+      auto itr = std::prev(t->rows.end());
+      *primary = itr->first;
+      return cache(t, itr->first);
+    }
+
+    auto& it = get_iterator(iterator);
+    auto itr = it.t->rows.find(it.pk);
+    if (itr == it.t->rows.begin()) return -1;
+    --itr;
+    *primary = itr->first;
+    return cache(it.t, itr->first);
+  }
+
+  int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t tbl, uint64_t id) {
+    counters().reads++;
+
+    auto* t = find_table(code, scope, tbl);
+    if (!t) return -1;
+
+    auto itr = t->rows.find(id);
+    if (itr == t->rows.end()) return end_iterator(t);
+    return cache(t, id);
+  }
+
+  int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t tbl, uint64_t id) {
+    counters().reads++;
+
+    auto* t = find_table(code, scope, tbl);
+    if (!t) return -1;
+
+    auto itr = t->rows.lower_bound(id);
+    if (itr == t->rows.end()) return end_iterator(t);
+    return cache(t, itr->first);
+  }
+
+  int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t tbl, uint64_t id) {
+    counters().reads++;
+
+    auto* t = find_table(code, scope, tbl);
+    if (!t) return -1;
+
+    auto itr = t->rows.upper_bound(id);
+    if (itr == t->rows.end()) return end_iterator(t);
+    return cache(t, itr->first);
+  }
+
+  int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t tbl) {
+    counters().reads++;
+
+    auto* t = find_table(code, scope, tbl);
+    if (!t) return -1;
+    return end_iterator(t);
+  }
+
+  void prints(const char* cstr) {
+    print_raw(cstr, std::strlen(cstr));
+  }
+
+  void prints_l(const char* cstr, uint32_t len) {
+    print_raw(cstr, len);
+  }
+
+  void printi(int64_t value) {
+    char buf[24];
+    int n = std::snprintf(buf, sizeof(buf), "%" PRId64, value);
+    print_raw(buf, n);
+  }
+
+  void printui(uint64_t value) {
+    char buf[24];
+    int n = std::snprintf(buf, sizeof(buf), "%" PRIu64, value);
+    print_raw(buf, n);
+  }
+
+  void printdf(double value) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.17g", value);
+    print_raw(buf, n);
+  }
+
+  void printn(uint64_t n) {
+    auto s = eosio::name(n).to_string();
+    print_raw(s.data(), s.size());
+  }
+
+  void printhex(const void* data, uint32_t datalen) {
+    static const char* hex = "0123456789abcdef";
+    auto* c = (const uint8_t*)data;
+    std::string out;
+    out.reserve(datalen * 2);
+    for (uint32_t i = 0; i < datalen; ++i) {
+      out += hex[c[i] >> 4];
+      out += hex[c[i] & 0x0f];
+    }
+    print_raw(out.data(), out.size());
+  }
+
+}}
@@ -19,6 +19,10 @@
 #include <eosio/asset.hpp>
 #include <eosio/crypto.hpp>
 #include <eosio/system.hpp>
+#include <eosio/binary_extension.hpp>
+#include <latest.hpp>
+#include <algorithm>
+#include <cstring>
 #include <math.h>
 
 using namespace eosio;
@@ -36,6 +40,76 @@ using namespace eosio;
 
 static const std::string system_str("system");
 
+//Datapoints an oracle's counter accumulates before being folded into the global count, as a fraction of vote_interval
+static const uint64_t counter_folds_per_vote = 100;
+
+//Number of producers voted for by the contract
+static const uint64_t voted_producers = 30;
+
+//Upper bound on global stats rows ranked per refreshvotes call once the leaderboard is not enough
+static const uint64_t refresh_votes_batch = 50;
+
+//Upper bound on users scored per sweepusers call
+static const uint64_t sweep_users_max_batch = 500;
+
+//Rows erased by clear, deletepair and cancelbounty before the rest is left to teardown calls,
+//and the most a teardown call may be asked to erase
+static const uint64_t teardown_batch = 200;
+static const uint64_t teardown_max_batch = 1000;
+
+//Age in seconds after which compactdons folds a donation row into its donator's aggregate, and the most
+//rows a compactdons call may be asked to fold
+static const uint64_t donation_retention = 2592000;
+static const uint64_t compact_max_batch = 1000;
+
+//Rows a migratedata call walks when it is not given a batch
+static const uint64_t migrate_batch = 500;
+
+//Most bars a getbars call returns
+static const uint32_t query_max_bars = 500;
+
+//Most legs a derived pair may be computed from
+static const uint64_t derived_max_legs = 4;
+
+//Tables walked by migratedata, in order. The pair stages are repeated for every pair in delphibackup
+static const uint8_t migrate_global = 0;
+static const uint8_t migrate_stats = 1;
+static const uint8_t migrate_pairs = 2;
+static const uint8_t migrate_pair_stats = 3;
+static const uint8_t migrate_pair_datapoints = 4;
+static const uint8_t migrate_done = 5;
+
+//Fixed-point scale of the reward accumulators, rewards::index is in 1/reward_index_precision larimer per datapoint
+static const uint128_t reward_index_precision = 1000000000000000000;
+
+//Length of a bar in seconds for each rollup tier
+static const uint64_t minute_bar_interval = 60;
+static const uint64_t hour_bar_interval = 3600;
+static const uint64_t day_bar_interval = 86400;
+
+//Diagnostic output, compiled in only when building with DELPHI_TRACE. Each trace is one line made of
+//an event name followed by key=value fields, e.g. "write.quote pair=eosusd value=58500"
+#ifdef DELPHI_TRACE
+  #define TRACE(event, ...) delphi_trace(event, ##__VA_ARGS__)
+#else
+  #define TRACE(event, ...) ((void)0)
+#endif
+
+inline void delphi_trace_fields() {}
+
+template<typename Key, typename Value, typename... Fields>
+void delphi_trace_fields(const Key& key, const Value& value, const Fields&... fields) {
+  eosio::print(" ", key, "=", value);
+  delphi_trace_fields(fields...);
+}
+
+template<typename... Fields>
+void delphi_trace(const char* event, const Fields&... fields) {
+  eosio::print(event);
+  delphi_trace_fields(fields...);
+  eosio::print("\n");
+}
+
 const checksum256 NULL_HASH;
 const eosio::time_point NULL_TIME_POINT = eosio::time_point(eosio::microseconds(0));
 
@@ -72,7 +146,7 @@ CONTRACT delphioracle : public eosio::contract {
   };
 
   struct pairinput {
-    name name;
+    eosio::name name;
     symbol base_symbol;
     asset_type base_type;
     eosio::name base_contract;
@@ -89,6 +163,61 @@ CONTRACT delphioracle : public eosio::contract {
     name pair;
   };
 
+  //Oracle ranked in a leaderboard
+  struct leader {
+    name owner;
+    uint64_t count;
+  };
+
+  //Datapoint stored in a packed window
+  struct window_point {
+    name owner;
+    uint64_t value;
+    time_point timestamp;
+  };
+
+  //Returned by write and writebatch for each accepted quote, the pair's median after the write, how many
+  //points of its window hold a datapoint and when the write happened
+  struct write_result {
+    name pair;
+    uint64_t median;
+    uint64_t fill;
+    time_point timestamp;
+  };
+
+  //Returned by gettwap, the time-weighted average median of a pair between from and to, after rounding
+  struct twap_view {
+    name pair;
+    time_point_sec from;
+    time_point_sec to;
+    uint64_t average;
+  };
+
+  //A fed pair a derived pair is computed from, divided into the cross rate instead of multiplied when inverted
+  struct derived_leg {
+    name pair;
+    bool invert;
+  };
+
+  //Returned by getwindow, the points of a pair's window oldest first and the median at the last write
+  struct window_view {
+    name pair;
+    uint64_t median;
+    std::vector<window_point> points;
+  };
+
+  //Returned by getstats, an oracle's stats in a scope, its place on the scope's leaderboard counting
+  //from 1 (0 when off the board) and the donation share it would collect on its next write or claim
+  struct oracle_view {
+    name owner;
+    name scope;
+    uint64_t count;
+    time_point timestamp;
+    asset balance;
+    uint64_t rank;
+    asset pending;
+  };
+
   //eosmechanics::cpu
   struct event {
     uint64_t value;
@@ -167,6 +296,44 @@ CONTRACT delphioracle : public eosio::contract {
 
   };
 
+  //Holds datapoints counted per oracle and not yet folded into global::total_datapoints_count, so the
+  //write path only touches the config row once every fold_size datapoints of an oracle
+  TABLE counters {
+    name owner;
+    uint64_t unfolded;
+
+    uint64_t primary_key() const {return owner.value;}
+  };
+
+  //Holds the oracles with the most datapoints in a stats scope, highest count first, kept incrementally as
+  //counts change. It holds max(paid, voted_producers) oracles, and the first paid of them share donations
+  TABLE leaderboard {
+    name scope;
+    uint64_t paid;
+    std::vector<leader> leaders;
+
+    uint64_t primary_key() const {return scope.value;}
+  };
+
+  //Holds the donation accumulator of a stats scope, _self for global donations or a pair name.
+  //Each donation adds amount / total to index, total being the counts of the paid leaders of the scope,
+  //and carry keeps the remainder of that division so no fraction of a larimer is lost
+  TABLE rewards {
+    name scope;
+    uint128_t index;
+    uint128_t carry;
+
+    uint64_t primary_key() const {return scope.value;}
+  };
+
+  //Holds the rewards::index an oracle was last settled at, scoped by owner with one row per stats scope
+  TABLE settlements {
+    name scope;
+    uint128_t index;
+
+    uint64_t primary_key() const {return scope.value;}
+  };
+
   TABLE oglobal {
     uint64_t id;
     uint64_t total_datapoints_count;
@@ -189,6 +356,81 @@ CONTRACT delphioracle : public eosio::contract {
 
   };
 
+  //Holds a sorted copy of each pair's datapoints window, kept in step with the
+  //datapoints table on every write so the median is read by position
+  TABLE medians {
+    name pair;
+    std::vector<uint64_t> sorted;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Holds the whole datapoints window of a pair in a single row, as a ring buffer of up to
+  //datapoints_per_instrument points where cursor is the oldest point, next to be overwritten.
+  //Pairs are moved to this layout from the datapoints table with packwindow
+  TABLE windows {
+    name pair;
+    uint64_t cursor;
+    uint64_t median;
+    std::vector<window_point> points;
+    std::vector<uint64_t> sorted;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Holds each pair's most recent median in a fixed size row, so consumer contracts read the price in one
+  //lookup. samples counts the datapoints accepted for the pair and precision is its quoted_precision.
+  //Layout is shared with delphi::latest_price in latest.hpp
+  TABLE latest {
+    name pair;
+    uint64_t median;
+    time_point timestamp;
+    uint64_t samples;
+    uint64_t precision;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Pairs no oracle writes, computed on read as the product of the latest medians of their legs, at
+  //precision decimals. Layout is read by delphi::read_derived in latest.hpp
+  TABLE derived {
+    name pair;
+    std::vector<derived_leg> legs;
+    uint64_t precision;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Per pair accumulator of each median times the seconds it was in effect, advanced on every write.
+  //period is the checkpoint period of the last write and started the time of the first, when the
+  //accumulator was 0. Layout is shared with delphi::twap_state in latest.hpp
+  TABLE twap {
+    name pair;
+    uint64_t median;
+    time_point updated;
+    uint128_t cumulative;
+    uint64_t period;
+    time_point started;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //A pair's twap cumulative at the start of a checkpoint period, in a ring of delphi::twap_ring_size slots
+  //scoped by pair. Layout is read by delphi::read_cumulative in latest.hpp
+  TABLE checkpoints {
+    uint64_t slot;
+    uint64_t period;
+    uint128_t cumulative;
+
+    uint64_t primary_key() const {return slot;}
+
+  };
+
   //Holds the last hashes from qualified oracles
   TABLE hashes {
     uint64_t id;
@@ -213,17 +455,21 @@ CONTRACT delphioracle : public eosio::contract {
     asset balance;
 
     uint64_t primary_key() const {return owner.value;}
-    uint64_t by_count() const {return -count;}
 
   };
 
-  //Holds aggregated datapoints
+  //Holds aggregated datapoints, one bar per interval with the open, high, low and close of the medians
+  //accepted during that interval. median is the median of the window at the last sample.
+  //Minute bars are stored in bars, and each closed bar is merged into the next tier, hourbars then daybars
   TABLE bars {
     uint64_t id;
 
+    uint64_t open;
     uint64_t high;
     uint64_t low;
+    uint64_t close;
     uint64_t median;
+    uint64_t samples;
     time_point timestamp;
 
     uint64_t primary_key() const {return id;}
@@ -234,7 +480,7 @@ CONTRACT delphioracle : public eosio::contract {
   //Holds bounties information
   TABLE bounties {
 
-    name name;
+    eosio::name name;
     std::string description;
     asset bounty;
 
@@ -257,10 +503,23 @@ CONTRACT delphioracle : public eosio::contract {
 
   };
 
+  //Holds each user's donations folded into one row. total counts every donation from id counted_from on,
+  //older rows were recorded before the aggregate existed and are added when compactdons folds them.
+  //Until then voteabuser adds them up itself
+  TABLE donors {
+
+    name donator;
+    asset total;
+    uint64_t counted_from;
+
+    uint64_t primary_key() const {return donator.value;}
+
+  };
+
   //Holds users information
   TABLE users {
 
-    name name;
+    eosio::name name;
     asset contribution;
     uint64_t score;
     time_point creation_timestamp;
@@ -270,20 +529,154 @@ CONTRACT delphioracle : public eosio::contract {
 
   };
 
+  //Holds the pairs being torn down. The pairs row is already gone so writes stop, and the pair cannot be
+  //proposed again until teardown calls have erased everything left in its scopes
+  TABLE teardowns {
+
+    name pair;
+    time_point requested;
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Holds the progress of the users score sweep, sweepusers resumes at cursor while running
+  TABLE sweepstate {
+
+    uint64_t id;
+    bool running = false;
+    name cursor;
+    uint64_t updated;
+    time_point started;
+    time_point completed;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the progress of migratedata's walk over delphibackup. stage is the table being walked, scope the
+  //pair of the pair stages and next_key the primary key the next call resumes at. copied counts the rows
+  //copied so far, rows that already existed here are not counted
+  TABLE migration {
+
+    uint64_t id;
+    uint8_t stage = migrate_global;
+    name scope;
+    uint64_t next_key = 0;
+    uint64_t copied = 0;
+    time_point started;
+    time_point completed;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the stake voted against each oracle, kept as a running tally by voteabuser and unvoteabuser.
+  //flagged is set once votes reaches the abusestate threshold, write rejects flagged oracles
   TABLE abusers {
 
-    name name;
+    eosio::name name;
     uint64_t votes;
+    bool flagged = false;
 
     uint64_t primary_key() const {return name.value;}
     uint64_t by_votes() const {return votes;}
 
   };
 
+  //Holds each abuse vote with the stake it was cast with, found by (voter, abuser)
+  TABLE abusevotes {
+
+    uint64_t id;
+    name voter;
+    name abuser;
+    uint64_t stake;
+    time_point timestamp;
+
+    uint64_t primary_key() const {return id;}
+    uint128_t by_voter_abuser() const {return composite_key(voter.value, abuser.value);}
+
+  };
+
+  //Holds how many bars each tier keeps. Without it every tier keeps bars_per_instrument bars
+  TABLE barretention {
+
+    uint64_t id;
+    uint64_t minute;
+    uint64_t hour;
+    uint64_t day;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the stake voted against an oracle at which it is flagged, 0 flags no one
+  TABLE abusestate {
+
+    uint64_t id;
+    uint64_t threshold;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the accounts currently qualified as oracles, a cache of the top minimum_rank eosio producers
+  TABLE oracles {
+
+    name owner;
+
+    uint64_t primary_key() const {return owner.value;}
+
+  };
+
+  //Holds when the oracles cache was last rebuilt and how many accounts it holds
+  TABLE oraclestate {
+
+    uint64_t id;
+    time_point refreshed;
+    uint64_t count;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the two most recent revealed multiparty digests so writehash chains in one read.
+  //hex_chaining hashes the hex text of the previous digest, as the contract originally did
+  TABLE chainstate {
+
+    uint64_t id;
+    bool synced = false;
+    bool hex_chaining = false;
+    name latest_owner;
+    checksum256 latest;
+    name previous_owner;
+    checksum256 previous;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
+  //Holds the progress of the producer vote refresh that becomes due every vote_interval datapoints.
+  //When the global leaderboard holds fewer than voted_producers qualified oracles, refreshvotes ranks the
+  //global stats rows in batches, resuming at cursor with the best qualified oracles found so far in ranked
+  TABLE votestate {
+
+    uint64_t id;
+    bool due = false;
+    bool scanning = false;
+    name cursor;
+    std::vector<leader> ranked;
+    time_point requested;
+    time_point last_vote;
+
+    uint64_t primary_key() const {return id;}
+
+  };
+
   //Holds custodians information
   TABLE custodians {
 
-    name name;
+    eosio::name name;
 
     uint64_t primary_key() const {return name.value;}
 
@@ -296,8 +689,8 @@ CONTRACT delphioracle : public eosio::contract {
     bool bounty_awarded = false;
     bool bounty_edited_by_custodians = false;
 
-    name proposer;
-    name name;
+    eosio::name proposer;
+    eosio::name name;
 
     asset bounty_amount = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
 
@@ -318,10 +711,50 @@ CONTRACT delphioracle : public eosio::contract {
 
   };
 
+  //Holds the part of a pair the write path reads and writes, a fixed size row so quotes never deserialize
+  //the pair's metadata and approval lists. It is the live copy of active, bounty_awarded and bounty_amount,
+  //pairs only picks them up on governance changes and once the bounty is awarded
+  TABLE pairstate {
+
+    name pair;
+    bool active = false;
+    bool bounty_awarded = false;
+    asset bounty_amount = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+
+    uint64_t primary_key() const {return pair.value;}
+
+  };
+
+  //Holds each account's approval of a bounty, found by (bounty, voter). An account that is both a
+  //custodian and a qualified oracle approves in both roles from the same row
+  TABLE approvals {
+
+    uint64_t id;
+    name bounty;
+    name voter;
+    bool custodian = false;
+    bool oracle = false;
+
+    uint64_t primary_key() const {return id;}
+    uint128_t by_bounty_voter() const {return composite_key(bounty.value, voter.value);}
+
+  };
+
+  //Holds how many custodians and oracles approve each bounty, kept in step with approvals
+  TABLE bountytally {
+
+    name bounty;
+    uint64_t custodians = 0;
+    uint64_t oracles = 0;
+
+    uint64_t primary_key() const {return bounty.value;}
+
+  };
+
   //Holds the list of pairs
   TABLE networks {
 
-    name name;
+    eosio::name name;
 
     uint64_t primary_key() const {return name.value;}
 
@@ -367,19 +800,57 @@ CONTRACT delphioracle : public eosio::contract {
   //Multi index types definition
   typedef eosio::multi_index<"global"_n, global> globaltable;
   typedef eosio::multi_index<"global"_n, oglobal> oglobaltable;
+  typedef eosio::multi_index<"counters"_n, counters> counterstable;
+  typedef eosio::multi_index<"leaderboard"_n, leaderboard> leaderboardtable;
+  typedef eosio::multi_index<"rewards"_n, rewards> rewardstable;
+  typedef eosio::multi_index<"settlements"_n, settlements> settlementstable;
 
   typedef eosio::multi_index<"custodians"_n, custodians> custodianstable;
 
-  typedef eosio::multi_index<"stats"_n, stats,
-      indexed_by<"count"_n, const_mem_fun<stats, uint64_t, &stats::by_count>>> statstable;
+  typedef eosio::multi_index<"votestate"_n, votestate> votestatetable;
+
+  typedef eosio::multi_index<"sweepstate"_n, sweepstate> sweepstatetable;
+
+  typedef eosio::multi_index<"teardowns"_n, teardowns> teardownstable;
+
+  typedef eosio::multi_index<"migration"_n, migration> migrationtable;
+
+  typedef eosio::multi_index<"oracles"_n, oracles> oraclestable;
+  typedef eosio::multi_index<"oraclestate"_n, oraclestate> oraclestatetable;
+
+  typedef eosio::multi_index<"chainstate"_n, chainstate> chainstatetable;
+
+  typedef eosio::multi_index<"stats"_n, stats> statstable;
 
   typedef eosio::multi_index<"pairs"_n, pairs> pairstable;
   typedef eosio::multi_index<"npairs"_n, pairs> npairstable;
+  typedef eosio::multi_index<"pairstate"_n, pairstate> pairstatetable;
+  typedef eosio::multi_index<"latest"_n, latest> latesttable;
+  typedef eosio::multi_index<"derived"_n, derived> derivedtable;
+  typedef eosio::multi_index<"twap"_n, twap> twaptable;
+  typedef eosio::multi_index<"checkpoints"_n, checkpoints> checkpointstable;
 
+  typedef eosio::multi_index<"approvals"_n, approvals,
+      indexed_by<"bountyvoter"_n, const_mem_fun<approvals, uint128_t, &approvals::by_bounty_voter>>> approvalstable;
+  typedef eosio::multi_index<"bountytally"_n, bountytally> bountytallytable;
+
+  //Nothing reads the value index since the medians row, it stays because indexes are numbered by position
   typedef eosio::multi_index<"datapoints"_n, datapoints,
       indexed_by<"value"_n, const_mem_fun<datapoints, uint64_t, &datapoints::by_value>>, 
       indexed_by<"timestamp"_n, const_mem_fun<datapoints, uint64_t, &datapoints::by_timestamp>>> datapointstable;
 
+  typedef eosio::multi_index<"medians"_n, medians> medianstable;
+  typedef eosio::multi_index<"windows"_n, windows> windowstable;
+
+  typedef eosio::multi_index<"bars"_n, bars,
+      indexed_by<"timestamp"_n, const_mem_fun<bars, uint64_t, &bars::by_timestamp>>> barstable;
+
+  typedef eosio::multi_index<"hourbars"_n, bars,
+      indexed_by<"timestamp"_n, const_mem_fun<bars, uint64_t, &bars::by_timestamp>>> hourbarstable;
+
+  typedef eosio::multi_index<"daybars"_n, bars,
+      indexed_by<"timestamp"_n, const_mem_fun<bars, uint64_t, &bars::by_timestamp>>> daybarstable;
+
   typedef eosio::multi_index<"hashes"_n, hashes,
       indexed_by<"timestamp"_n, const_mem_fun<hashes, uint64_t, &hashes::by_timestamp>>,
       indexed_by<"owner"_n, const_mem_fun<hashes, uint64_t, &hashes::by_owner>>,
@@ -394,12 +865,21 @@ CONTRACT delphioracle : public eosio::contract {
   typedef eosio::multi_index<"donations"_n, donations,
       indexed_by<"donator"_n, const_mem_fun<donations, uint64_t, &donations::by_donator>>> donationstable;
 
+  typedef eosio::multi_index<"donors"_n, donors> donorstable;
+
   typedef eosio::multi_index<"users"_n, users,
       indexed_by<"score"_n, const_mem_fun<users, uint64_t, &users::by_score>>> userstable;
 
   typedef eosio::multi_index<"abusers"_n, abusers,
       indexed_by<"votes"_n, const_mem_fun<abusers, uint64_t, &abusers::by_votes>>> abuserstable;
 
+  typedef eosio::multi_index<"abusevotes"_n, abusevotes,
+      indexed_by<"voterabuser"_n, const_mem_fun<abusevotes, uint128_t, &abusevotes::by_voter_abuser>>> abusevotestable;
+
+  typedef eosio::multi_index<"abusestate"_n, abusestate> abusestatetable;
+
+  typedef eosio::multi_index<"retention"_n, barretention> retentiontable;
+
   //typedef eosio::multi_index<"bounties"_n, bounties> bountiestable;
 
   std::string to_hex( const char* d, uint32_t s ) 
@@ -413,7 +893,8 @@ CONTRACT delphioracle : public eosio::contract {
   }
 
   //Write datapoint
-  ACTION write(const name owner, const std::vector<quote>& quotes);
+  [[eosio::action]] std::vector<write_result> write(const name owner, const std::vector<quote>& quotes);
+  [[eosio::action]] std::vector<write_result> writebatch(const name owner, const std::vector<quote>& quotes);
   ACTION writehash(const name owner, const checksum256 hash, const std::string reveal);
   ACTION forfeithash(const name owner);
   ACTION claim(name owner);
@@ -428,41 +909,62 @@ CONTRACT delphioracle : public eosio::contract {
   ACTION addcustodian(name name);
   ACTION delcustodian(name name);
   ACTION reguser(name owner);
-  ACTION clear(name pair);
+  [[eosio::action]] bool clear(name pair);
   ACTION updateusers();
   ACTION voteabuser(name owner, name abuser);
-  ACTION migratedata();
+  [[eosio::action]] migration migratedata(binary_extension<uint64_t> batch);
+  ACTION packwindow(name pair);
+  [[eosio::action]] uint64_t syncoracles();
+  ACTION refreshvotes();
+  ACTION setchainmode(bool hex);
+  [[eosio::action]] sweepstate sweepusers(uint64_t batch);
+  [[eosio::action]] uint64_t teardown(uint64_t batch);
+  ACTION compactdons(name donator, uint64_t batch);
+  ACTION unvoteabuser(name owner, name abuser);
+  ACTION setabuse(uint64_t threshold);
+  ACTION setretention(uint64_t minute, uint64_t hour, uint64_t day);
+  ACTION splitpairs(uint64_t batch);
+  ACTION dropcountidx(uint64_t batch);
+  ACTION setderived(name pair, std::vector<derived_leg> legs, uint64_t precision);
+  ACTION delderived(name pair);
+
+  //Read-only queries, answered through the action return value
+  [[eosio::action, eosio::read_only]] latest getlatest(name pair);
+  [[eosio::action, eosio::read_only]] window_view getwindow(name pair);
+  [[eosio::action, eosio::read_only]] std::vector<bars> getbars(name pair, name tier, time_point_sec from, time_point_sec to, uint32_t limit);
+  [[eosio::action, eosio::read_only]] leaderboard getleaders(name scope);
+  [[eosio::action, eosio::read_only]] oracle_view getstats(name owner, name scope);
+  [[eosio::action, eosio::read_only]] latest getderived(name pair);
+  [[eosio::action, eosio::read_only]] twap_view gettwap(name pair, time_point_sec from, time_point_sec to);
 
   [[eosio::on_notify("eosio.token::transfer")]]
   void transfer(uint64_t sender, uint64_t receiver) {
 
-    print("transfer notifier", "\n");
-
     auto transfer_data = unpack_action_data<delphioracle::st_transfer>();
 
-    print("transfer ", name{transfer_data.from}, " ",  name{transfer_data.to}, " ", transfer_data.quantity, "\n");
+    TRACE("transfer", "from", transfer_data.from, "to", transfer_data.to, "quantity", transfer_data.quantity);
 
     //if incoming transfer
     if (transfer_data.from != _self && transfer_data.to == _self){
 
       //check if memo contains the name of an existing pair
 
-      pairstable pairs(_self, _self.value);
+      pairstatetable pstate(_self, _self.value);
       //bountiestable bounties(_self, _self.value);
 
       //auto name_index = pairs.get_index<"name"_n>();
 
-      // print("name(transfer_data.memo)", name(transfer_data.memo), "\n");
-      // print("transfer_data.memo", transfer_data.memo, "\n");
-
       if (transfer_data.memo == system_str ) return; //transfer to system account
 
-      auto itr = pairs.find(name(transfer_data.memo).value);
+      //bounties, donation totals and payouts are all kept in the system token
+      check(transfer_data.quantity.symbol == symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION), "only the system token is accepted");
+
+      auto itr = load_pairstate(pstate, name(transfer_data.memo));
 
       //auto bitr = bounties.find(name(transfer_data.memo).value;
 
-      if (itr != pairs.end() && itr->bounty_awarded == true ) process_donation(transfer_data.from, itr->name, transfer_data.quantity);
-      else if (itr != pairs.end() && itr->bounty_awarded == false) process_bounty(transfer_data.from, itr->name, transfer_data.quantity);
+      if (itr != pstate.end() && itr->bounty_awarded == true ) process_donation(transfer_data.from, itr->pair, transfer_data.quantity);
+      else if (itr != pstate.end() && itr->bounty_awarded == false) process_bounty(pstate, itr, transfer_data.quantity);
       else process_donation(transfer_data.from, _self, transfer_data.quantity);
 
     }
@@ -470,6 +972,7 @@ CONTRACT delphioracle : public eosio::contract {
   }
 
   using write_action = action_wrapper<"write"_n, &delphioracle::write>;
+  using writebatch_action = action_wrapper<"writebatch"_n, &delphioracle::writebatch>;
   using writehash_action = action_wrapper<"writehash"_n, &delphioracle::writehash>;
   using claim_action = action_wrapper<"claim"_n, &delphioracle::claim>;
   using configure_action = action_wrapper<"configure"_n, &delphioracle::configure>;
@@ -487,6 +990,27 @@ CONTRACT delphioracle : public eosio::contract {
   using voteabuser_action = action_wrapper<"voteabuser"_n, &delphioracle::voteabuser>;
   using updateusers_action = action_wrapper<"updateusers"_n, &delphioracle::updateusers>;
   using migratedata_action = action_wrapper<"migratedata"_n, &delphioracle::migratedata>;
+  using packwindow_action = action_wrapper<"packwindow"_n, &delphioracle::packwindow>;
+  using syncoracles_action = action_wrapper<"syncoracles"_n, &delphioracle::syncoracles>;
+  using refreshvotes_action = action_wrapper<"refreshvotes"_n, &delphioracle::refreshvotes>;
+  using setchainmode_action = action_wrapper<"setchainmode"_n, &delphioracle::setchainmode>;
+  using sweepusers_action = action_wrapper<"sweepusers"_n, &delphioracle::sweepusers>;
+  using teardown_action = action_wrapper<"teardown"_n, &delphioracle::teardown>;
+  using compactdons_action = action_wrapper<"compactdons"_n, &delphioracle::compactdons>;
+  using unvoteabuser_action = action_wrapper<"unvoteabuser"_n, &delphioracle::unvoteabuser>;
+  using setabuse_action = action_wrapper<"setabuse"_n, &delphioracle::setabuse>;
+  using setretention_action = action_wrapper<"setretention"_n, &delphioracle::setretention>;
+  using splitpairs_action = action_wrapper<"splitpairs"_n, &delphioracle::splitpairs>;
+  using dropcountidx_action = action_wrapper<"dropcountidx"_n, &delphioracle::dropcountidx>;
+  using setderived_action = action_wrapper<"setderived"_n, &delphioracle::setderived>;
+  using delderived_action = action_wrapper<"delderived"_n, &delphioracle::delderived>;
+  using getlatest_action = action_wrapper<"getlatest"_n, &delphioracle::getlatest>;
+  using getwindow_action = action_wrapper<"getwindow"_n, &delphioracle::getwindow>;
+  using getbars_action = action_wrapper<"getbars"_n, &delphioracle::getbars>;
+  using getleaders_action = action_wrapper<"getleaders"_n, &delphioracle::getleaders>;
+  using getstats_action = action_wrapper<"getstats"_n, &delphioracle::getstats>;
+  using getderived_action = action_wrapper<"getderived"_n, &delphioracle::getderived>;
+  using gettwap_action = action_wrapper<"gettwap"_n, &delphioracle::gettwap>;
   using transfer_action = action_wrapper<name("transfer"), &delphioracle::transfer>;
 
 private:
@@ -495,265 +1019,1836 @@ private:
       return (uint128_t{x} << 64) | y;
   }
 
-  //Check if calling account is a qualified oracle
-  bool check_oracle(const name owner){
+  //Rebuild the oracles cache from the top of eosio::producers, only touching rows that changed.
+  //Returns the age in seconds of the cache that was replaced
+  uint64_t refresh_oracles(){
 
     globaltable gtable(_self, _self.value);
     producers_table ptable("eosio"_n, name("eosio").value);
+    oraclestable otable(_self, _self.value);
+    oraclestatetable ostate(_self, _self.value);
 
     auto gitr = gtable.begin();
 
+    check(gitr != gtable.end(), "contract not configured");
+
     auto p_idx = ptable.get_index<"prototalvote"_n>();
 
     auto p_itr = p_idx.begin();
 
+    std::vector<eosio::name> top;
+
     uint64_t count = 0;
 
     while (p_itr != p_idx.end()) {
-      if (p_itr->owner==owner) return true;
+      top.push_back(p_itr->owner);
       p_itr++;
       count++;
       if (count>gitr->minimum_rank) break;
     }
 
-    return false;
-  }
-
-  checksum256 get_multiparty_hash(const name owner, const std::string reveal){
+    std::sort(top.begin(), top.end());
 
-    hashestable htable(_self, _self.value);
+    auto itr = otable.begin();
 
-    auto itr = htable.rbegin();
+    while (itr != otable.end()) {
+      if (std::binary_search(top.begin(), top.end(), itr->owner)) itr++;
+      else itr = otable.erase(itr);
+    }
 
-    while (itr != htable.rend()){
-      if(itr->owner != owner && itr->reveal!=""){
-        
+    for (const auto& owner : top) {
+      if (otable.find(owner.value) == otable.end()) {
+        otable.emplace(_self, [&](auto& o) {
+          o.owner = owner;
+        });
+      }
+    }
 
-        std::string prev_multiparty = to_hex((char*)itr->multiparty.extract_as_byte_array().data(), sizeof(itr->multiparty));
+    time_point ctime = current_time_point();
+    uint64_t age = 0;
 
-        print("reveal:", reveal, "\n");
-        print("prev_multiparty:", prev_multiparty, "\n");
+    auto sitr = ostate.find(1);
 
-        std::string to_hash(prev_multiparty);
+    if (sitr == ostate.end()) {
 
-        to_hash+= reveal;
+      ostate.emplace(_self, [&](auto& s) {
+        s.id = 1;
+        s.refreshed = ctime;
+        s.count = top.size();
+      });
 
-        print("to_hash:", to_hash, "\n");
+    }
+    else {
 
-        checksum256 h = sha256(to_hash.c_str(), to_hash.length());
+      age = (ctime - sitr->refreshed).to_seconds();
 
-        print("h:", h, "\n");
+      ostate.modify(sitr, _self, [&](auto& s) {
+        s.refreshed = ctime;
+        s.count = top.size();
+      });
 
-        return h;
-      }
-      itr++;
     }
-    
-    return NULL_HASH;
+
+    return age;
 
   }
 
-  //Check if calling account is can vote on bounties
-  bool check_approver(const name owner){
+  //Check if calling account is a qualified oracle against the cached set, however old it is. Until the
+  //cache is first built the top of eosio::producers is read directly
+  bool check_oracle(const name owner){
 
-    globaltable gtable(_self, _self.value);
-    statstable stats(_self, _self.value);
+    oraclestatetable ostate(_self, _self.value);
 
-    auto gitr = gtable.begin();
-    auto itr = stats.find(owner.value);
+    if (ostate.find(1) == ostate.end()) return ranked_producer(owner);
 
-    if (gitr->approver_threshold == 0) return true;
-    else if (itr != stats.end() && itr->count >= gitr->approver_threshold) return true;
-    else return false;
+    oraclestable otable(_self, _self.value);
 
+    return otable.find(owner.value) != otable.end();
   }
 
-  bool check_user(const name owner){
+  bool ranked_producer(const name owner){
 
-    userstable utable(_self, _self.value);
+    globaltable gtable(_self, _self.value);
+    producers_table ptable("eosio"_n, name("eosio").value);
 
-    auto user = utable.find(owner.value);
+    auto gitr = gtable.begin();
 
-    if (user != utable.end()) return true;
-    else return false;
+    auto p_idx = ptable.get_index<"prototalvote"_n>();
 
-  }
+    auto p_itr = p_idx.begin();
 
-  //Ensure account cannot push data more often than every 60 seconds
-  void check_last_push(const name owner, const name pair){
+    uint64_t count = 0;
+
+    while (p_itr != p_idx.end()) {
+      if (p_itr->owner==owner) return true;
+      p_itr++;
+      count++;
+      if (count>gitr->minimum_rank) break;
+    }
+
+    return false;
+  }
+
+  //Check if an oracle has been flagged by abuse votes
+  bool check_abuser(const name owner){
+
+    abuserstable atable(_self, _self.value);
+
+    auto itr = atable.find(owner.value);
+
+    return itr != atable.end() && itr->flagged;
+  }
+
+  //Bars kept by each tier, bars_per_instrument for all of them until setretention is called
+  barretention bar_retention(const global& config){
+
+    retentiontable rstore(_self, _self.value);
+
+    auto itr = rstore.find(1);
+
+    if (itr != rstore.end()) return *itr;
+
+    return barretention{1, config.bars_per_instrument, config.bars_per_instrument, config.bars_per_instrument};
+  }
+
+  //Stake threshold at which an oracle is flagged, 0 when flagging is off
+  uint64_t abuse_threshold(){
+
+    abusestatetable astate(_self, _self.value);
+
+    auto itr = astate.find(1);
+
+    return itr == astate.end() ? 0 : itr->threshold;
+  }
+
+  //Move an oracle's abuse tally by the change in one voter's stake and flag it against the threshold.
+  //The row goes away when no stake is left on it
+  void tally_abuse(const name abuser, const uint64_t removed, const uint64_t added){
+
+    abuserstable atable(_self, _self.value);
+
+    auto itr = atable.find(abuser.value);
+
+    if (itr == atable.end()) {
+      itr = atable.emplace(_self, [&](auto& a) {
+        a.name = abuser;
+        a.votes = 0;
+      });
+    }
+
+    uint64_t votes = itr->votes - std::min(removed, itr->votes) + added;
+
+    if (votes == 0) {
+      atable.erase(itr);
+      return;
+    }
+
+    uint64_t threshold = abuse_threshold();
+
+    atable.modify(itr, _self, [&](auto& a) {
+      a.votes = votes;
+      a.flagged = threshold > 0 && votes >= threshold;
+    });
+
+  }
+
+  //Create the hot state row of a pair from its pairs row, billed to payer. Later updates keep that payer
+  pairstatetable::const_iterator create_pairstate(pairstatetable& pstate, const pairs& p, const name payer){
+
+    return pstate.emplace(payer, [&](auto& s) {
+      s.pair = p.name;
+      s.active = p.active;
+      s.bounty_awarded = p.bounty_awarded;
+      s.bounty_amount = p.bounty_amount;
+    });
+
+  }
+
+  //Find a pair's hot state row, creating it from the pairs row the first time a pair from before the
+  //split is used, billed to the contract. Returns end() when the pair does not exist
+  pairstatetable::const_iterator load_pairstate(pairstatetable& pstate, const name pair){
+
+    auto itr = pstate.find(pair.value);
+
+    if (itr != pstate.end()) return itr;
+
+    pairstable pairs(_self, _self.value);
+
+    auto pitr = pairs.find(pair.value);
+
+    if (pitr == pairs.end()) return itr;
+
+    return create_pairstate(pstate, *pitr, _self);
+
+  }
+
+  //Copy the live state of a pair back to its pairs row
+  void sync_pair(const pairstate& s){
+
+    pairstable pairs(_self, _self.value);
+
+    auto pitr = pairs.find(s.pair.value);
+
+    if (pitr == pairs.end()) return;
+
+    pairs.modify(pitr, _self, [&](auto& p) {
+      p.active = s.active;
+      p.bounty_awarded = s.bounty_awarded;
+      p.bounty_amount = s.bounty_amount;
+    });
+
+  }
+
+  //Load the chaining row, rebuilding it from the hashes table when missing or out of sync
+  chainstatetable::const_iterator load_chainstate(chainstatetable& cstate){
+
+    auto citr = cstate.find(1);
+
+    if (citr == cstate.end()) citr = cstate.emplace(_self, [&](auto& c) { c.id = 1; });
+    if (citr->synced) return citr;
+
+    hashestable htable(_self, _self.value);
+
+    name latest_owner;
+    name previous_owner;
+    checksum256 latest = NULL_HASH;
+    checksum256 previous = NULL_HASH;
+
+    auto itr = htable.rbegin();
+
+    while (itr != htable.rend() && previous_owner == name()){
+      if (itr->reveal!=""){
+        if (latest_owner == name()) {
+          latest_owner = itr->owner;
+          latest = itr->multiparty;
+        }
+        else if (itr->owner != latest_owner) {
+          previous_owner = itr->owner;
+          previous = itr->multiparty;
+        }
+      }
+      itr++;
+    }
+
+    TRACE("multiparty.sync", "latest", latest_owner, "previous", previous_owner);
+
+    cstate.modify(citr, _self, [&](auto& c) {
+      c.synced = true;
+      c.latest_owner = latest_owner;
+      c.latest = latest;
+      c.previous_owner = previous_owner;
+      c.previous = previous;
+    });
+
+    return citr;
+
+  }
+
+  //Mark the chaining row for rebuild when owner's revealed hash leaves the table
+  void unchain_owner(const name owner){
+
+    chainstatetable cstate(_self, _self.value);
+
+    auto citr = cstate.find(1);
+
+    if (citr == cstate.end() || !citr->synced) return;
+    if (citr->latest_owner != owner && citr->previous_owner != owner) return;
+
+    cstate.modify(citr, _self, [&](auto& c) {
+      c.synced = false;
+    });
+
+  }
+
+  //Chain owner's reveal onto the latest revealed digest from another oracle and record the result.
+  //Must be called before owner's previous hash row is erased
+  checksum256 get_multiparty_hash(const name owner, const std::string& reveal){
+
+    chainstatetable cstate(_self, _self.value);
+
+    auto citr = load_chainstate(cstate);
+
+    checksum256 h = NULL_HASH;
+
+    name prev_owner = citr->latest_owner != owner ? citr->latest_owner : citr->previous_owner;
+
+    if (prev_owner != name()) {
+
+      auto prev = (prev_owner == citr->latest_owner ? citr->latest : citr->previous).extract_as_byte_array();
+
+      const uint32_t prefix = citr->hex_chaining ? 2 * prev.size() : prev.size();
+      const uint32_t length = prefix + reveal.length();
+
+      char stack[256];
+      std::vector<char> heap;
+      char* buffer = stack;
+
+      if (length > sizeof(stack)) {
+        heap.resize(length);
+        buffer = heap.data();
+      }
+
+      if (citr->hex_chaining) {
+        const char* digits = "0123456789abcdef";
+        for (uint32_t i = 0; i < prev.size(); ++i) {
+          buffer[2*i] = digits[prev[i] >> 4];
+          buffer[2*i+1] = digits[prev[i] & 0x0f];
+        }
+      }
+      else memcpy(buffer, prev.data(), prev.size());
+
+      memcpy(buffer + prefix, reveal.data(), reveal.length());
+
+      h = sha256(buffer, length);
+
+      TRACE("multiparty.chain", "previous", prev_owner, "hex", citr->hex_chaining, "hash", h);
+
+    }
+
+    //An empty reveal is not chained on, so owner's row simply drops out
+    if (reveal == "") {
+      if (citr->latest_owner == owner || citr->previous_owner == owner) {
+        cstate.modify(citr, _self, [&](auto& c) {
+          c.synced = false;
+        });
+      }
+      return h;
+    }
+
+    cstate.modify(citr, _self, [&](auto& c) {
+      if (c.latest_owner != owner) {
+        c.previous_owner = c.latest_owner;
+        c.previous = c.latest;
+      }
+      c.latest_owner = owner;
+      c.latest = h;
+    });
+
+    return h;
+
+  }
+
+  //Check if calling account is can vote on bounties
+  bool check_approver(const name owner){
+
+    globaltable gtable(_self, _self.value);
+    statstable stats(_self, _self.value);
+
+    auto gitr = gtable.begin();
+    auto itr = stats.find(owner.value);
+
+    if (gitr->approver_threshold == 0) return true;
+    else if (itr != stats.end() && itr->count >= gitr->approver_threshold) return true;
+    else return false;
+
+  }
+
+  bool check_user(const name owner){
+
+    userstable utable(_self, _self.value);
+
+    auto user = utable.find(owner.value);
+
+    if (user != utable.end()) return true;
+    else return false;
+
+  }
+
+  //Ensure account cannot push data for a pair more often than every write_cooldown, and count the push on
+  //the oracle's stats row for that pair. Returns false instead of failing when strict is false
+  bool update_pair_stats(const name owner, const name pair, const global& config, const bool strict, asset& reward){
+
+    statstable store(_self, pair.value);
+
+    auto itr = store.find(owner.value);
+
+    time_point ctime = current_time_point();
+
+    if (itr != store.end()) {
+
+      time_point next_push = eosio::time_point(itr->timestamp.elapsed + eosio::microseconds(config.write_cooldown));
+
+      if (!strict && ctime < next_push) return false;
+
+      check(ctime>=next_push, "can only call every 60 seconds");
+
+      reward.amount += rank_oracle(pair, owner, itr->count, itr->count + 1, config);
+
+      store.modify( itr, _self, [&]( auto& s ) {
+        s.timestamp = ctime;
+        s.count++;
+      });
+
+    } else {
+
+      rank_oracle(pair, owner, 0, 1, config);
+
+      store.emplace(_self, [&](auto& s) {
+        s.owner = owner;
+        s.timestamp = ctime;
+        s.count = 1;
+        s.balance = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+        s.last_claim = NULL_TIME_POINT;
+      });
+
+    }
+
+    return true;
+
+  }
+
+  //Add count pushes and a reward to the oracle's global stats row, settling global donations first
+  void update_oracle_stats(statstable& gstore, statstable::const_iterator gsitr, const name owner, const uint64_t count, asset reward, const global& config){
+
+    time_point ctime = current_time_point();
+
+    if (gsitr != gstore.end()) {
+
+      reward.amount += rank_oracle(_self, owner, gsitr->count, gsitr->count + count, config);
+
+      gstore.modify( gsitr, _self, [&]( auto& s ) {
+        s.timestamp = ctime;
+        s.count += count;
+        s.balance += reward;
+      });
+
+    } else {
+
+      rank_oracle(_self, owner, 0, count, config);
+
+      gstore.emplace(_self, [&](auto& s) {
+        s.owner = owner;
+        s.timestamp = ctime;
+        s.count = count;
+        s.balance = reward;
+        s.last_claim = NULL_TIME_POINT;
+      });
+
+    }
+
+  }
+
+  //Leaderboard order: highest count first, ties broken by account name like the former count index
+  static bool ranks_before(const leader& a, const leader& b){
+    return a.count > b.count || (a.count == b.count && a.owner.value < b.owner.value);
+  }
+
+  static uint64_t leaderboard_size(const uint64_t paid){
+    return std::max(paid, voted_producers);
+  }
+
+  //Load the leaderboard of a stats scope, ranking the whole scope when it is missing or global::paid changed.
+  //Oracles leaving the paid places through the rebuild are settled and credited, except writer whose
+  //share is added to writer_owed for the caller to credit
+  leaderboardtable::const_iterator load_leaderboard(leaderboardtable& ltable, const name scope, const global& config, const name writer, uint64_t& writer_owed){
+
+    auto litr = ltable.find(scope.value);
+
+    if (litr != ltable.end() && litr->paid == config.paid) return litr;
+
+    statstable store(_self, scope.value);
+
+    uint64_t size = leaderboard_size(config.paid);
+
+    std::vector<leader> leaders;
+
+    for (const auto& s : store) {
+      leader l{s.owner, s.count};
+      if (leaders.size() == size && !ranks_before(l, leaders.back())) continue;
+      leaders.insert(std::upper_bound(leaders.begin(), leaders.end(), l, ranks_before), l);
+      if (leaders.size() > size) leaders.pop_back();
+    }
+
+    TRACE("leaderboard.rank", "scope", scope, "paid", config.paid, "leaders", leaders.size());
+
+    rewardstable rtable(_self, _self.value);
+
+    auto ritr = rtable.find(scope.value);
+
+    if (ritr != rtable.end()) {
+
+      static const std::vector<leader> none;
+
+      const std::vector<leader>& before = litr != ltable.end() ? litr->leaders : none;
+
+      uint64_t old_paid = litr != ltable.end() ? std::min<uint64_t>(litr->paid, before.size()) : 0;
+      uint64_t paid = std::min<uint64_t>(config.paid, leaders.size());
+
+      auto holds = [](const std::vector<leader>& list, const uint64_t places, const name owner) {
+        return std::any_of(list.begin(), list.begin() + places, [&](const leader& l) {return l.owner == owner;});
+      };
+
+      //counts have not changed, only who holds a paid place
+      for (uint64_t i = 0; i < paid; i++) {
+        if (!holds(before, old_paid, leaders[i].owner)) settle_rewards(rtable, ritr, leaders[i].owner, 0);
+      }
+
+      for (uint64_t i = 0; i < old_paid; i++) {
+        const name owner = before[i].owner;
+        if (holds(leaders, paid, owner)) continue;
+        uint64_t owed = settle_rewards(rtable, ritr, owner, live_count(scope, owner));
+        if (owner == writer) writer_owed += owed;
+        else credit_oracle(owner, owed);
+      }
+
+    }
+
+    if (litr == ltable.end()) {
+      return ltable.emplace(_self, [&](auto& l) {
+        l.scope = scope;
+        l.paid = config.paid;
+        l.leaders = leaders;
+      });
+    }
+
+    ltable.modify(litr, _self, [&](auto& l) {
+      l.paid = config.paid;
+      l.leaders = leaders;
+    });
+
+    return litr;
+
+  }
+
+  //Datapoints owner pushed in a stats scope. The leaderboard keeps a lower bound of it, exact as of the
+  //last time the board was rewritten
+  uint64_t live_count(const name scope, const name owner){
+
+    statstable store(_self, scope.value);
+
+    auto itr = store.find(owner.value);
+
+    return itr != store.end() ? itr->count : 0;
+
+  }
+
+  //Move owner up the scope's leaderboard from previous to count datapoints. The board is only rewritten when
+  //a place changes. The count of a leader owner might pass is read from its stats row, as the board only holds
+  //a lower bound of it. An oracle entering the paid places pushes the last paid one out, and both are settled
+  //at the count they held. Returns larimers owed to owner
+  uint64_t rank_oracle(const name scope, const name owner, const uint64_t previous, const uint64_t count, const global& config){
+
+    leaderboardtable ltable(_self, _self.value);
+
+    uint64_t owed = 0;
+
+    auto litr = load_leaderboard(ltable, scope, config, owner, owed);
+
+    const std::vector<leader>& board = litr->leaders;
+
+    uint64_t size = leaderboard_size(config.paid);
+    leader ranked{owner, count};
+
+    uint64_t from = std::find_if(board.begin(), board.end(), [&](const leader& l) {return l.owner == owner;}) - board.begin();
+    uint64_t to = from;
+
+    //leaders owner passes at their live count, and the one it stopped behind once its count was read
+    std::vector<leader> passed;
+    uint64_t blocked = 0;
+
+    while (to > 0 && ranks_before(ranked, board[to - 1])) {
+      leader ahead{board[to - 1].owner, live_count(scope, board[to - 1].owner)};
+      if (!ranks_before(ranked, ahead)) {
+        blocked = ahead.count;
+        break;
+      }
+      passed.push_back(ahead);
+      to--;
+    }
+
+    bool entered = from == board.size() && (board.size() < size || to < from);
+
+    leader displaced;
+    bool pushed_out = from >= config.paid && to < config.paid && std::max<uint64_t>(board.size(), from + 1) > config.paid;
+
+    if (to < from || entered) {
+
+      std::vector<leader> leaders = board;
+
+      if (from < leaders.size()) leaders.erase(leaders.begin() + from);
+
+      leaders.insert(leaders.begin() + to, ranked);
+
+      for (uint64_t i = 0; i < passed.size(); i++) leaders[to + passed.size() - i] = passed[i];
+      if (blocked > 0) leaders[to - 1].count = blocked;
+
+      if (pushed_out) displaced = leaders[config.paid];
+      if (leaders.size() > size) leaders.pop_back();
+
+      ltable.modify(litr, _self, [&](auto& l) {
+        l.leaders = leaders;
+      });
+
+    }
+
+    rewardstable rtable(_self, _self.value);
+
+    auto ritr = rtable.find(scope.value);
+
+    if (ritr == rtable.end()) return owed;
+
+    if (pushed_out) {
+      TRACE("leaderboard.unpaid", "scope", scope, "owner", displaced.owner);
+      credit_oracle(displaced.owner, settle_rewards(rtable, ritr, displaced.owner, displaced.count));
+    }
+
+    if (from >= config.paid && to >= config.paid) return owed;
+
+    return owed + settle_rewards(rtable, ritr, owner, from < config.paid ? previous : 0);
+
+  }
+
+  //Load the accumulator of a stats scope, created at index 0 on the scope's first donation. The paid leaders
+  //are settled at 0 when it is created, they may hold settlement rows from a torn down pair of the same name
+  rewardstable::const_iterator load_rewards(rewardstable& rtable, const leaderboard& board){
+
+    auto ritr = rtable.find(board.scope.value);
+
+    if (ritr != rtable.end()) return ritr;
+
+    ritr = rtable.emplace(_self, [&](auto& r) {
+      r.scope = board.scope;
+      r.index = 0;
+      r.carry = 0;
+    });
+
+    uint64_t paid = std::min<uint64_t>(board.paid, board.leaders.size());
+
+    for (uint64_t i = 0; i < paid; i++) settle_rewards(rtable, ritr, board.leaders[i].owner, 0);
+
+    return ritr;
+
+  }
+
+  //Spread a donation over the datapoints of the scope's paid leaders
+  void accrue_rewards(const name scope, const uint64_t amount){
+
+    globaltable gtable(_self, _self.value);
+    leaderboardtable ltable(_self, _self.value);
+    rewardstable rtable(_self, _self.value);
+
+    uint64_t owed = 0;
+
+    auto litr = load_leaderboard(ltable, scope, *gtable.begin(), name(), owed);
+    auto ritr = load_rewards(rtable, *litr);
+
+    uint64_t paid = std::min<uint64_t>(litr->paid, litr->leaders.size());
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < paid; i++) total += live_count(scope, litr->leaders[i].owner);
+
+    TRACE("rewards.accrue", "scope", scope, "paid", paid, "total", total);
+
+    //nobody to pay yet, as before the donation stays with the contract
+    if (total == 0) return;
+
+    uint128_t scaled = uint128_t(amount) * reward_index_precision + ritr->carry;
+
+    rtable.modify(ritr, _self, [&](auto& r) {
+      r.index += scaled / total;
+      r.carry = scaled % total;
+    });
+
+  }
+
+  //Larimers earned by count datapoints since the accumulator stood at index
+  uint64_t rewards_owed(const rewards& r, const uint128_t index, const uint64_t count){
+
+    return uint64_t(uint128_t(count) * (r.index - index) / reward_index_precision);
+
+  }
+
+  //Settle what owner earned in the accumulator's scope since the last settlement, count being owner's
+  //datapoints in that scope while it held a paid place, 0 otherwise. Returns larimers owed
+  uint64_t settle_rewards(rewardstable& rtable, rewardstable::const_iterator ritr, const name owner, const uint64_t count){
+
+    settlementstable settled(_self, owner.value);
+
+    auto sitr = settled.find(ritr->scope.value);
+
+    //an oracle without a settlement row was last settled when the accumulator was created at index 0
+    uint128_t index = sitr != settled.end() ? sitr->index : 0;
+    uint64_t owed = rewards_owed(*ritr, index, count);
+
+    if (sitr == settled.end()) {
+      settled.emplace(_self, [&](auto& s) {
+        s.scope = ritr->scope;
+        s.index = ritr->index;
+      });
+    }
+    else if (index != ritr->index) {
+      settled.modify(sitr, _self, [&](auto& s) {
+        s.index = ritr->index;
+      });
+    }
+
+    return owed;
+
+  }
+
+  //Credit settled rewards to an oracle other than the one writing
+  void credit_oracle(const name owner, const uint64_t amount){
+
+    if (amount == 0) return;
+
+    statstable gstore(_self, _self.value);
+
+    auto itr = gstore.find(owner.value);
+
+    //global stats may have been cleared while the oracle still ranks in a pair
+    if (itr == gstore.end()) {
+      gstore.emplace(_self, [&](auto& s) {
+        s.owner = owner;
+        s.timestamp = current_time_point();
+        s.count = 0;
+        s.balance = asset(amount, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+        s.last_claim = NULL_TIME_POINT;
+      });
+      return;
+    }
+
+    gstore.modify(itr, _self, [&](auto& s) {
+      s.balance.amount += amount;
+    });
+
+  }
+
+  //Ensure account cannot push data more often than every 60 seconds
+  void check_last_push(const name owner, const name pair){
+
+    globaltable gtable(_self, _self.value);
+    statstable gstore(_self, _self.value);
+
+    auto gitr = gtable.begin();
+
+    asset reward = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+
+    update_pair_stats(owner, pair, *gitr, true, reward);
+    update_oracle_stats(gstore, gstore.find(owner.value), owner, 1, reward, *gitr);
+
+  }
+
+  //Add to the oracle's datapoints counter. Once it holds vote_interval / counter_folds_per_vote datapoints
+  //it is folded into the global count, and a vote refresh is flagged if a vote_interval boundary was crossed
+  void count_datapoints(globaltable& gtable, globaltable::const_iterator gitr, const name owner, const uint64_t count){
+
+    counterstable counters(_self, _self.value);
+
+    uint64_t fold_size = std::max<uint64_t>(1, gitr->vote_interval / counter_folds_per_vote);
+
+    auto citr = counters.find(owner.value);
+    uint64_t unfolded = count;
+
+    if (citr != counters.end()) unfolded += citr->unfolded;
+
+    uint64_t remaining = unfolded >= fold_size ? 0 : unfolded;
+
+    if (citr != counters.end()) {
+
+      counters.modify(citr, _self, [&](auto& c) {
+        c.unfolded = remaining;
+      });
+
+    }
+    else {
+
+      counters.emplace(_self, [&](auto& c) {
+        c.owner = owner;
+        c.unfolded = remaining;
+      });
+
+    }
+
+    if (remaining > 0) return;
+
+    uint64_t previous = gitr->total_datapoints_count;
+
+    gtable.modify(gitr, _self, [&](auto& s) {
+      s.total_datapoints_count += unfolded;
+    });
+
+    TRACE("datapoints.fold", "owner", owner, "folded", unfolded, "total", gitr->total_datapoints_count);
+
+    if (previous / gitr->vote_interval != gitr->total_datapoints_count / gitr->vote_interval){
+      request_votes();
+    }
+
+  }
+
+  //Flag that the contract should refresh its producer votes, the ranking itself is done by refreshvotes
+  void request_votes(){
+
+    votestatetable vstate(_self, _self.value);
+
+    auto vitr = vstate.find(1);
+
+    if (vitr == vstate.end()) {
+
+      vstate.emplace(_self, [&](auto& v) {
+        v.id = 1;
+        v.due = true;
+        v.requested = current_time_point();
+        v.last_vote = NULL_TIME_POINT;
+      });
+
+    }
+    else if (!vitr->due) {
+
+      vstate.modify(vitr, _self, [&](auto& v) {
+        v.due = true;
+        v.requested = current_time_point();
+      });
+
+    }
+
+  }
+
+  //Vote for the top voted_producers qualified oracles by datapoints contributed, and clear the request.
+  //The global leaderboard answers in one call when it holds enough of them. Otherwise every call ranks up
+  //to refresh_votes_batch global stats rows and the vote is sent once the last one is ranked
+  void update_votes(){
+
+    votestatetable vstate(_self, _self.value);
+    globaltable gtable(_self, _self.value);
+    leaderboardtable ltable(_self, _self.value);
+
+    auto vitr = vstate.find(1);
+
+    check(vitr != vstate.end() && vitr->due, "no vote refresh due");
+
+    std::vector<leader> ranked;
+
+    if (!vitr->scanning) {
+
+      uint64_t owed = 0;
+
+      auto litr = load_leaderboard(ltable, _self, *gtable.begin(), name(), owed);
+
+      for (const auto& l : litr->leaders) {
+        if (ranked.size() == voted_producers) break;
+        TRACE("votes.rank", "owner", l.owner, "count", l.count);
+        if (check_oracle(l.owner)) ranked.push_back(l);
+      }
+
+      //oracles off the board rank below all of its leaders, and a board with room left holds every oracle
+      bool complete = ranked.size() == voted_producers || litr->leaders.size() < leaderboard_size(litr->paid);
+
+      if (!complete) {
+        vstate.modify(vitr, _self, [&](auto& v) {
+          v.scanning = true;
+          v.cursor = name();
+          v.ranked.clear();
+        });
+        return;
+      }
+
+    }
+    else {
+
+      statstable gstore(_self, _self.value);
+
+      ranked = vitr->ranked;
+
+      auto itr = gstore.lower_bound(vitr->cursor.value);
+
+      for (uint64_t i = 0; i < refresh_votes_batch && itr != gstore.end(); i++, itr++) {
+        leader l{itr->owner, itr->count};
+        if (ranked.size() == voted_producers && !ranks_before(l, ranked.back())) continue;
+        if (!check_oracle(l.owner)) continue;
+        ranked.insert(std::upper_bound(ranked.begin(), ranked.end(), l, ranks_before), l);
+        if (ranked.size() > voted_producers) ranked.pop_back();
+      }
+
+      TRACE("votes.scan", "ranked", ranked.size(), "done", itr == gstore.end());
+
+      if (itr != gstore.end()) {
+        name cursor = itr->owner;
+        vstate.modify(vitr, _self, [&](auto& v) {
+          v.cursor = cursor;
+          v.ranked = ranked;
+        });
+        return;
+      }
+
+    }
+
+    std::vector<eosio::name> bps;
+
+    for (const auto& l : ranked) bps.push_back(l.owner);
+
+    TRACE("votes.send", "producers", bps.size());
+
+    sort(bps.begin(), bps.end());
+
+    action act(
+      permission_level{_self, "active"_n},
+      "eosio"_n, "voteproducer"_n,
+      std::make_tuple(_self, ""_n, bps)
+    );
+    act.send();
+
+    vstate.modify(vitr, _self, [&](auto& v) {
+      v.due = false;
+      v.scanning = false;
+      v.cursor = name();
+      v.ranked.clear();
+      v.last_vote = current_time_point();
+    });
+
+  }
+
+  //Median of a sorted window: middle value for odd sizes, mean of the two middle values for even sizes
+  static uint64_t window_median(const std::vector<uint64_t>& sorted){
+
+    uint64_t size = sorted.size();
+
+    if (size == 0) return 0;
+    if (size % 2 == 1) return sorted[size / 2];
+
+    uint64_t low = sorted[size / 2 - 1];
+    uint64_t high = sorted[size / 2];
+
+    return low + (high - low) / 2;
+
+  }
+
+  static void window_insert(std::vector<uint64_t>& sorted, const uint64_t value){
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+  }
+
+  static void window_evict(std::vector<uint64_t>& sorted, const uint64_t value){
+    auto itr = std::lower_bound(sorted.begin(), sorted.end(), value);
+    check(itr != sorted.end() && *itr == value, "median window out of sync with datapoints");
+    sorted.erase(itr);
+  }
+
+  //Pairs created before the medians table existed get their sorted window built once from the datapoints
+  medianstable::const_iterator load_median_window(medianstable& mtable, datapointstable& dstore, const name pair){
+
+    auto mitr = mtable.find(pair.value);
+
+    if (mitr != mtable.end()) return mitr;
+
+    std::vector<uint64_t> sorted;
+
+    for (auto ditr = dstore.begin(); ditr != dstore.end(); ditr++) sorted.push_back(ditr->value);
+
+    std::sort(sorted.begin(), sorted.end());
+
+    return mtable.emplace(_self, [&](auto& m) {
+      m.pair = pair;
+      m.sorted = sorted;
+    });
+
+  }
+
+  //Allocates the empty datapoints window of a new pair, paid by the proposer
+  void create_datapoints(const name payer, const name pair, const uint64_t size){
+
+    datapointstable dstore(_self, pair.value);
+    medianstable mtable(_self, _self.value);
+    teardownstable teardowns(_self, _self.value);
+
+    check(teardowns.find(pair.value) == teardowns.end(), "pair is still being torn down");
+
+    for (uint64_t i=0; i < size; i++){
+
+      dstore.emplace(payer, [&](auto& s) {
+        s.id = i;
+        s.value = 0;
+        s.timestamp = NULL_TIME_POINT;
+      });
+
+    }
+
+    mtable.emplace(payer, [&](auto& m) {
+      m.pair = pair;
+      m.sorted = std::vector<uint64_t>(size, 0);
+    });
+
+  }
+
+  //Bars of a tier opened between from and to, oldest first and at most limit of them
+  template<typename T>
+  std::vector<bars> collect_bars(T& bstore, const time_point_sec from, const time_point_sec to, const uint32_t limit){
+
+    std::vector<bars> result;
+
+    auto t_idx = bstore.template get_index<"timestamp"_n>();
+
+    for (auto itr = t_idx.lower_bound(from.sec_since_epoch()); itr != t_idx.end() && result.size() < limit; itr++) {
+      if (itr->by_timestamp() > to.sec_since_epoch()) break;
+      result.push_back(*itr);
+    }
+
+    return result;
+
+  }
+
+  //Erase up to budget rows from the front of a table. Returns the number of rows erased
+  template<typename T>
+  uint64_t erase_rows(T& table, const uint64_t budget){
+
+    uint64_t erased = 0;
+
+    auto itr = table.begin();
+
+    while (itr != table.end() && erased < budget) {
+      itr = table.erase(itr);
+      erased++;
+    }
+
+    return erased;
+
+  }
+
+  //Erase up to budget entries of the count index stats rows carried before the leaderboard replaced it.
+  //Nothing reads or updates them any more, and erasing a stats row no longer removes its entry.
+  //Returns the number of entries erased
+  uint64_t erase_count_index(const name scope, const uint64_t budget){
+
+    typedef _multi_index_detail::secondary_index_db_functions<uint64_t> idx64;
+
+    //first secondary index of the stats table
+    const uint64_t table = "stats"_n.value & 0xFFFFFFFFFFFFFFF0ULL;
+
+    uint64_t erased = 0;
+
+    while (erased < budget) {
+      uint64_t secondary = 0;
+      uint64_t primary = 0;
+      int32_t itr = idx64::db_idx_lowerbound(_self.value, scope.value, table, secondary, primary);
+      if (itr < 0) break;
+      idx64::db_idx_remove(itr);
+      erased++;
+    }
+
+    return erased;
+
+  }
+
+  //Erase up to budget rows of a pair's stats scope, each oracle's settlement row for the pair before
+  //its stats row. Returns the number of rows erased
+  uint64_t erase_stats(statstable& store, const name pair, const uint64_t budget){
+
+    uint64_t erased = 0;
+
+    for (auto itr = store.begin(); itr != store.end() && erased < budget; erased++) {
+
+      settlementstable settled(_self, itr->owner.value);
+
+      auto sitr = settled.find(pair.value);
+
+      if (sitr != settled.end()) settled.erase(sitr);
+      else itr = store.erase(itr);
+
+    }
+
+    return erased;
+
+  }
+
+  //Erase up to budget approvals of a bounty. Returns the number of rows erased
+  uint64_t erase_approvals(const name bounty, const uint64_t budget){
+
+    approvalstable approvals(_self, _self.value);
+
+    auto a_idx = approvals.get_index<"bountyvoter"_n>();
+    auto itr = a_idx.lower_bound(composite_key(bounty.value, 0));
+
+    uint64_t erased = 0;
+
+    while (itr != a_idx.end() && itr->bounty == bounty && erased < budget) {
+      itr = a_idx.erase(itr);
+      erased++;
+    }
+
+    return erased;
+
+  }
+
+  //Find a bounty's approval tally. A bounty voted on before approvals had their own table gets its
+  //in-row approval lists moved over the first time, and the lists are emptied
+  bountytallytable::const_iterator load_tally(bountytallytable& tallies, pairstable& pairs, pairstable::const_iterator pitr){
+
+    auto titr = tallies.find(pitr->name.value);
+
+    if (titr != tallies.end()) return titr;
+
+    approvalstable approvals(_self, _self.value);
+
+    auto a_idx = approvals.get_index<"bountyvoter"_n>();
+
+    auto approve = [&](const name voter, const bool custodian) {
+      auto aitr = a_idx.find(composite_key(pitr->name.value, voter.value));
+      if (aitr == a_idx.end()) {
+        approvals.emplace(_self, [&](auto& a) {
+          a.id = approvals.available_primary_key();
+          a.bounty = pitr->name;
+          a.voter = voter;
+          a.custodian = custodian;
+          a.oracle = !custodian;
+        });
+      }
+      else {
+        a_idx.modify(aitr, _self, [&](auto& a) {
+          if (custodian) a.custodian = true;
+          else a.oracle = true;
+        });
+      }
+    };
+
+    for (const auto& c : pitr->approving_custodians) approve(c, true);
+    for (const auto& o : pitr->approving_oracles) approve(o, false);
+
+    titr = tallies.emplace(_self, [&](auto& t) {
+      t.bounty = pitr->name;
+      t.custodians = pitr->approving_custodians.size();
+      t.oracles = pitr->approving_oracles.size();
+    });
+
+    if (!pitr->approving_custodians.empty() || !pitr->approving_oracles.empty()) {
+      pairs.modify(pitr, _self, [&](auto& p) {
+        p.approving_custodians.clear();
+        p.approving_oracles.clear();
+      });
+    }
+
+    return titr;
+
+  }
+
+  //Tombstone a pair whose pairs row is being erased, billed to payer. Its scopes are emptied by run_teardowns
+  void request_teardown(const name pair, const name payer){
+
+    teardownstable teardowns(_self, _self.value);
+
+    if (teardowns.find(pair.value) != teardowns.end()) return;
+
+    //writes stop with the hot row, whatever else is left of the pair
+    pairstatetable pstate(_self, _self.value);
+
+    auto sitr = pstate.find(pair.value);
+    if (sitr != pstate.end()) pstate.erase(sitr);
+
+    teardowns.emplace(payer, [&](auto& t) {
+      t.pair = pair;
+      t.requested = current_time_point();
+    });
+
+  }
+
+  //Erase what is left of a torn down pair, spending at most budget rows. Returns the budget left,
+  //the pair is gone once some is left over
+  uint64_t teardown_pair(const name pair, uint64_t budget){
+
+    medianstable mtable(_self, _self.value);
+    windowstable wtable(_self, _self.value);
+    leaderboardtable ltable(_self, _self.value);
+    rewardstable rtable(_self, _self.value);
+
+    auto mitr = mtable.find(pair.value);
+    if (mitr != mtable.end()) mtable.erase(mitr);
+
+    auto witr = wtable.find(pair.value);
+    if (witr != wtable.end()) wtable.erase(witr);
+
+    latesttable lstore(_self, _self.value);
+
+    auto lsitr = lstore.find(pair.value);
+    if (lsitr != lstore.end()) lstore.erase(lsitr);
+
+    twaptable ttable(_self, _self.value);
+
+    auto tsitr = ttable.find(pair.value);
+    if (tsitr != ttable.end()) ttable.erase(tsitr);
+
+    //paid leaders are credited before their stats go, then the board, its settlement rows and the
+    //accumulator are erased so claim no longer visits the pair. Oracles that left the board were
+    //settled then, their rows go with their stats below
+    auto litr = ltable.find(pair.value);
+    auto ritr = rtable.find(pair.value);
+
+    if (litr != ltable.end()) {
+      uint64_t paid = std::min<uint64_t>(litr->paid, litr->leaders.size());
+      for (uint64_t i = 0; i < litr->leaders.size(); i++) {
+        const auto& l = litr->leaders[i];
+        settlementstable settled(_self, l.owner.value);
+        auto sitr = settled.find(pair.value);
+        uint128_t index = sitr != settled.end() ? sitr->index : 0;
+        if (i < paid && ritr != rtable.end()) credit_oracle(l.owner, rewards_owed(*ritr, index, live_count(pair, l.owner)));
+        if (sitr != settled.end()) settled.erase(sitr);
+      }
+      ltable.erase(litr);
+    }
+
+    if (ritr != rtable.end()) rtable.erase(ritr);
+
+    bountytallytable tallies(_self, _self.value);
+
+    auto titr = tallies.find(pair.value);
+    if (titr != tallies.end()) tallies.erase(titr);
+
+    datapointstable dstore(_self, pair.value);
+    barstable bars(_self, pair.value);
+    hourbarstable hourbars(_self, pair.value);
+    daybarstable daybars(_self, pair.value);
+    statstable store(_self, pair.value);
+    checkpointstable ctable(_self, pair.value);
+
+    budget -= erase_approvals(pair, budget);
+    budget -= erase_rows(dstore, budget);
+    budget -= erase_rows(bars, budget);
+    budget -= erase_rows(hourbars, budget);
+    budget -= erase_rows(daybars, budget);
+    budget -= erase_stats(store, pair, budget);
+    budget -= erase_count_index(pair, budget);
+    budget -= erase_rows(ctable, budget);
+
+    return budget;
+
+  }
+
+  //Work through the tombstoned pairs, spending at most budget rows. Returns the budget left, every
+  //tombstone is cleared once some is left over
+  uint64_t run_teardowns(uint64_t budget){
+
+    teardownstable teardowns(_self, _self.value);
+
+    auto itr = teardowns.begin();
+
+    while (itr != teardowns.end() && budget > 0) {
+
+      budget = teardown_pair(itr->pair, budget);
+
+      TRACE("teardown.pair", "pair", itr->pair, "left", budget);
+
+      if (budget == 0) break;
+
+      itr = teardowns.erase(itr);
+
+    }
+
+    return budget;
+
+  }
+
+  //Hand the rows of source from next_key on to copy, at most budget of them. Returns true once
+  //the table is walked to its end
+  template<typename T, typename F>
+  bool migrate_rows(T& source, uint64_t& next_key, uint64_t& budget, F&& copy){
+
+    auto itr = source.lower_bound(next_key);
+
+    while (itr != source.end() && budget > 0) {
+      copy(*itr);
+      next_key = itr->primary_key() + 1;
+      budget--;
+      itr++;
+    }
+
+    return itr == source.end();
+
+  }
+
+  //Walk at most budget rows of delphibackup from the cursor held in m, copying them and counting the copies
+  //in m.copied. A row whose key already exists here is left alone, so a retried call never duplicates it.
+  //Returns the number of rows walked
+  uint64_t migrate_walk(migration& m, uint64_t budget){
+
+    const name backup = "delphibackup"_n;
+
+    leaderboardtable ltable(_self, _self.value);
+    npairstable bpairs(backup, backup.value);
+
+    uint64_t start = budget;
+
+    while (budget > 0 && m.stage != migrate_done) {
+
+      bool walked = false;
+
+      if (m.stage == migrate_global) {
+
+        oglobaltable source(backup, backup.value);
+        globaltable dest(_self, _self.value);
+
+        walked = migrate_rows(source, m.next_key, budget, [&](const auto& row) {
+          if (dest.find(row.id) != dest.end()) return;
+          dest.emplace(_self, [&](auto& g){
+            g.id = row.id;
+            g.total_datapoints_count = row.total_datapoints_count;
+            g.datapoints_per_instrument = 21;
+            g.bars_per_instrument = 30;
+            g.vote_interval = 10000;
+            g.write_cooldown = 55000000;
+            g.approver_threshold = 1;
+            g.approving_oracles_threshold = 2;
+            g.approving_custodians_threshold = 1;
+            g.minimum_rank = 105;
+            g.paid = 21;
+            g.min_bounty_delay = 604800;
+            g.new_bounty_delay = 259200;
+          });
+          m.copied++;
+        });
+
+      }
+      else if (m.stage == migrate_stats || m.stage == migrate_pair_stats) {
+
+        name scope = m.stage == migrate_stats ? _self : m.scope;
+
+        statstable source(backup, m.stage == migrate_stats ? backup.value : scope.value);
+        statstable dest(_self, scope.value);
+
+        walked = migrate_rows(source, m.next_key, budget, [&](const auto& row) {
+          if (dest.find(row.owner.value) != dest.end()) return;
+          dest.emplace(_self, [&](auto& s){
+            s.owner = row.owner;
+            s.timestamp = row.timestamp;
+            s.count = row.count;
+            s.last_claim = row.last_claim;
+            s.balance = row.balance;
+          });
+          m.copied++;
+        });
+
+        //migrated counts are ranked again on next use
+        if (walked) {
+          auto litr = ltable.find(scope.value);
+          if (litr != ltable.end()) ltable.erase(litr);
+        }
+
+      }
+      else if (m.stage == migrate_pairs) {
+
+        pairstable dest(_self, _self.value);
+
+        walked = migrate_rows(bpairs, m.next_key, budget, [&](const auto& row) {
+          if (dest.find(row.name.value) != dest.end()) return;
+          dest.emplace(_self, [&](auto& p){
+            p.active = row.active;
+            p.bounty_awarded = row.bounty_awarded;
+            p.bounty_edited_by_custodians = row.bounty_edited_by_custodians;
+            p.proposer = row.proposer;
+            p.name = row.name;
+            p.bounty_amount = row.bounty_amount;
+            p.base_symbol = row.base_symbol;
+            p.base_type = row.base_type;
+            p.base_contract = row.base_contract;
+            p.quote_symbol = row.quote_symbol;
+            p.quote_type = row.quote_type;
+            p.quote_contract = row.quote_contract;
+            p.quoted_precision = row.quoted_precision;
+          });
+          m.copied++;
+        });
+
+      }
+      else {
+
+        datapointstable source(backup, m.scope.value);
+        datapointstable dest(_self, m.scope.value);
+
+        walked = migrate_rows(source, m.next_key, budget, [&](const auto& row) {
+          if (dest.find(row.id) != dest.end()) return;
+          dest.emplace(_self, [&](auto& d){
+            d.id = row.id;
+            d.owner = row.owner;
+            d.value = row.value;
+            d.median = row.median;
+            d.timestamp = row.timestamp;
+          });
+          m.copied++;
+        });
+
+      }
+
+      if (!walked) break;
+
+      m.next_key = 0;
+
+      //pairs are walked in name order, the pair stages move on to the next pair once its datapoints are done
+      if (m.stage == migrate_pairs || m.stage == migrate_pair_datapoints) {
+        auto pitr = m.stage == migrate_pairs ? bpairs.begin() : bpairs.upper_bound(m.scope.value);
+        m.stage = pitr == bpairs.end() ? migrate_done : migrate_pair_stats;
+        m.scope = pitr == bpairs.end() ? name() : pitr->name;
+      }
+      else m.stage++;
+
+    }
+
+    return start - budget;
 
-    globaltable gtable(_self, _self.value);
-    statstable gstore(_self, _self.value);
-    statstable store(_self, pair.value);
+  }
 
-    auto gitr = gtable.begin();
-    auto itr = store.find(owner.value);
+  //Replace the oldest row of the datapoints table, pop oldest rows if the window is larger than window_size
+  uint64_t push_datapoint(const name owner, const uint64_t value, const name pair, const uint64_t window_size){
 
-    if (itr != store.end()) {
+    datapointstable dstore(_self, pair.value);
+    medianstable mtable(_self, _self.value);
 
-      time_point ctime = current_time_point();
-      auto last = store.get(owner.value);
+    auto mitr = load_median_window(mtable, dstore, pair);
 
-      time_point next_push = eosio::time_point(last.timestamp.elapsed + eosio::microseconds(gitr->write_cooldown));
+    std::vector<uint64_t> sorted = mitr->sorted;
+    uint64_t median = 0;
 
-      check(ctime>=next_push, "can only call every 60 seconds");
+    auto t_idx = dstore.get_index<"timestamp"_n>();
 
-      store.modify( itr, _self, [&]( auto& s ) {
-        s.timestamp = ctime;
-        s.count++;
-      });
+    //Window was shrunk by configure, pop the oldest points until the new one replaces the last of them
+    while (sorted.size() > window_size) {
+      auto oldest = t_idx.begin();
+      window_evict(sorted, oldest->value);
+      t_idx.erase(oldest);
+    }
 
-    } else {
+    if (sorted.size() < window_size) {
 
-      store.emplace(_self, [&](auto& s) {
+      //Window was grown by configure, append instead of replacing the oldest point
+      window_insert(sorted, value);
+      median = window_median(sorted);
+
+      dstore.emplace(_self, [&](auto& s) {
+        s.id = dstore.available_primary_key();
         s.owner = owner;
+        s.value = value;
+        s.median = median;
         s.timestamp = current_time_point();
-        s.count = 1;
-        s.balance = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
-        s.last_claim = NULL_TIME_POINT;
       });
 
     }
+    else {
 
-    auto gsitr = gstore.find(owner.value);
-    if (gsitr != gstore.end()) {
-
-      time_point ctime = current_time_point();
-
-      gstore.modify( gsitr, _self, [&]( auto& s ) {
-        s.timestamp = ctime;
-        s.count++;
-      });
+      auto oldest = t_idx.begin();
 
-    } else {
+      window_evict(sorted, oldest->value);
+      window_insert(sorted, value);
+      median = window_median(sorted);
 
-      gstore.emplace(_self, [&](auto& s) {
+      t_idx.modify(oldest, _self, [&](auto& s) {
         s.owner = owner;
+        s.value = value;
+        s.median = median;
         s.timestamp = current_time_point();
-        s.count = 1;
-        s.balance = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
-        s.last_claim = NULL_TIME_POINT;
       });
 
     }
 
+    mtable.modify(mitr, _self, [&](auto& m) {
+      m.sorted = sorted;
+    });
+
+    return median;
+
   }
 
-  void update_votes(){
+  //Overwrite the oldest point of a packed window in place, one row read and one row write
+  uint64_t push_window_point(windowstable& wtable, windowstable::const_iterator witr, const name owner, const uint64_t value, const uint64_t window_size){
 
-    print("voting for bps:", "\n");
+    uint64_t median = 0;
 
-    std::vector<eosio::name> bps;
+    wtable.modify(witr, _self, [&](auto& w) {
 
-    statstable gstore(_self, _self.value);
+      window_point p{owner, value, current_time_point()};
 
-    auto sorted_idx = gstore.get_index<"count"_n>();
-    auto itr = sorted_idx.begin();
+      //Window was shrunk by configure, drop the oldest points
+      while (w.points.size() > window_size) {
+        window_evict(w.sorted, w.points[w.cursor].value);
+        w.points.erase(w.points.begin() + w.cursor);
+        if (w.cursor == w.points.size()) w.cursor = 0;
+      }
 
-    uint64_t count = 0;
+      if (w.points.size() < window_size) {
+        //Window not full yet, the new point goes in front of the oldest one
+        w.points.insert(w.points.begin() + w.cursor, p);
+      }
+      else {
+        window_evict(w.sorted, w.points[w.cursor].value);
+        w.points[w.cursor] = p;
+      }
+
+      w.cursor = (w.cursor + 1) % w.points.size();
+
+      window_insert(w.sorted, value);
+
+      w.median = window_median(w.sorted);
+      median = w.median;
+
+    });
+
+    return median;
+
+  }
+
+  //Merge a sample into the latest bar of a tier, or open a new bar when the sample falls in a later interval
+  //and drop the oldest bars beyond retention. Returns true with the bar that was closed when a new one is opened
+  template<typename T>
+  bool fold_bar(const name pair, const bars sample, const uint64_t interval, const uint64_t retention, bars& closed){
+
+    T bstore(_self, pair.value);
+
+    uint64_t start = sample.timestamp.sec_since_epoch();
+    time_point open_time = time_point(seconds(start - start % interval));
+
+    bool has_closed = false;
+
+    auto latest = bstore.end();
+
+    if (latest != bstore.begin()) {
+
+      latest--;
+
+      if (latest->timestamp == open_time) {
+
+        bstore.modify(latest, _self, [&](auto& b) {
+          b.high = std::max(b.high, sample.high);
+          b.low = std::min(b.low, sample.low);
+          b.close = sample.close;
+          b.median = sample.median;
+          b.samples += sample.samples;
+        });
+
+        return false;
 
-    while(itr != sorted_idx.end() && count<30){
-      print(itr->owner, "\n");
-      if(check_oracle(itr->owner) == true) {
-        bps.push_back(itr->owner);
-        count++;
       }
 
-      itr++;
+      closed = *latest;
+      has_closed = true;
+
     }
 
-    sort(bps.begin(), bps.end());
+    uint64_t id = bstore.available_primary_key();
+
+    bstore.emplace(_self, [&](auto& b) {
+      b = sample;
+      b.id = id;
+      b.timestamp = open_time;
+    });
+
+    while (id - bstore.begin()->id >= retention) bstore.erase(bstore.begin());
+
+    return has_closed;
 
-    action act(
-      permission_level{_self, "active"_n},
-      "eosio"_n, "voteproducer"_n,
-      std::make_tuple(_self, ""_n, bps)
-    );
-    act.send();
- 
   }
 
-  //Push oracle message on top of queue, pop oldest element if queue size is larger than datapoints_count
-  void update_datapoints(const name owner, const uint64_t value, pairstable::const_iterator pair_itr){
+  //Fold a median into the pair's current minute bar. A minute bar that closes is merged into the hour tier,
+  //and an hour bar that closes into the day tier. Each tier keeps its own number of bars, a tier kept at 0
+  //is not built and neither are the coarser tiers fed from it
+  void update_bars(const name pair, const uint64_t median, const barretention& keep){
 
-    globaltable gtable(_self, _self.value);
-    datapointstable dstore(_self, pair_itr->name.value);
+    //Windows still mostly made of placeholder points have no meaningful median yet
+    if (median == 0 || keep.minute == 0) return;
+
+    bars sample{0, median, median, median, median, median, 1, current_time_point()};
+    bars closed;
+
+    if (!fold_bar<barstable>(pair, sample, minute_bar_interval, keep.minute, closed) || keep.hour == 0) return;
+    if (!fold_bar<hourbarstable>(pair, closed, hour_bar_interval, keep.hour, closed) || keep.day == 0) return;
+
+    fold_bar<daybarstable>(pair, closed, day_bar_interval, keep.day, closed);
+
+  }
+
+  //Push oracle message on top of queue, pop oldest element if queue size is larger than datapoints_per_instrument.
+  //Returns the new median with the window fill
+  write_result update_datapoints(const name owner, const uint64_t value, const name pair, windowstable& wtable, latesttable& lstore, twaptable& ttable, const global& config, const barretention& keep){
+
+    auto witr = wtable.find(pair.value);
 
     uint64_t median = 0;
-    //uint64_t primary_key ;
 
-    //Calculate new primary key by substracting one from the previous one
- /*   auto latest = dstore.begin();
-    primary_key = latest->id - 1;*/
+    if (witr != wtable.end()) median = push_window_point(wtable, witr, owner, value, config.datapoints_per_instrument);
+    else median = push_datapoint(owner, value, pair, config.datapoints_per_instrument);
 
-    auto t_idx = dstore.get_index<"timestamp"_n>();
+    update_bars(pair, median, keep);
 
-    auto oldest = t_idx.begin();
+    uint64_t samples = update_latest(lstore, wtable, pair, median);
 
-/*
+    update_twap(ttable, pair, median);
 
-  auto idx = hashtable.get_index<"producer"_n>();
-    auto itr = idx.find(producer);
-    if (itr != idx.end()) {
-      idx.modify(itr, producer, [&](auto& prod_hash) {
-        prod_hash.hash = hash;
-      });
-    } else {*/
+    return write_result{pair, median, std::min(samples, config.datapoints_per_instrument), current_time_point()};
 
+  }
 
-    //Pop oldest point
-    //t_idx.erase(oldest);
+  //Points of a pair's window that hold a datapoint rather than the placeholder the window was created with
+  uint64_t filled_points(windowstable& wtable, const name pair){
 
-    //Insert next datapoint
-/*    auto c_itr = dstore.emplace(_self, [&](auto& s) {
-      s.id = primary_key;
-      s.owner = owner;
-      s.value = value;
-      s.timestamp = current_time_point().sec_since_epoch();
-    });*/
+    uint64_t filled = 0;
 
+    auto witr = wtable.find(pair.value);
 
-    t_idx.modify(oldest, _self, [&](auto& s) {
-     // s.id = primary_key;
-      s.owner = owner;
-      s.value = value;
-      s.timestamp = current_time_point();
-    });
+    if (witr != wtable.end()) {
+      for (const auto& p : witr->points) if (p.timestamp != NULL_TIME_POINT) filled++;
+      return filled;
+    }
+
+    datapointstable dstore(_self, pair.value);
+
+    for (auto itr = dstore.begin(); itr != dstore.end(); itr++) if (itr->timestamp != NULL_TIME_POINT) filled++;
+
+    return filled;
+
+  }
 
-    //Get index sorted by value
-    auto value_sorted = dstore.get_index<"value"_n>();
-
-    //skip first 10 values
-    auto itr = value_sorted.begin();
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-    itr++;
-
-    median=itr->value;
-
-    //set median
-    t_idx.modify(oldest, _self, [&](auto& s) {
-      s.median = median;
+  //Record a pair's new median in its latest row and return its samples. The row is created on the pair's
+  //first datapoint, the only time the pairs row is read for the precision and the window is counted
+  uint64_t update_latest(latesttable& lstore, windowstable& wtable, const name pair, const uint64_t median){
+
+    auto litr = lstore.find(pair.value);
+
+    if (litr == lstore.end()) {
+
+      pairstable pairs(_self, _self.value);
+
+      auto pitr = pairs.find(pair.value);
+
+      //a pair from before the latest table already has points in its window
+      uint64_t samples = filled_points(wtable, pair);
+
+      lstore.emplace(_self, [&](auto& l) {
+        l.pair = pair;
+        l.median = median;
+        l.timestamp = current_time_point();
+        l.samples = samples;
+        l.precision = pitr != pairs.end() ? pitr->quoted_precision : 0;
+      });
+
+      return samples;
+
+    }
+
+    lstore.modify(litr, _self, [&](auto& l) {
+      l.median = median;
+      l.timestamp = current_time_point();
+      l.samples++;
     });
 
-    gtable.modify(gtable.begin(), _self, [&](auto& s) {
-      s.total_datapoints_count++;
+    return litr->samples;
+
+  }
+
+  //Record the cumulative at the start of period in its slot of a pair's checkpoint ring
+  void write_checkpoint(checkpointstable& ctable, const uint64_t period, const uint128_t cumulative){
+
+    uint64_t slot = period % delphi::twap_ring_size;
+
+    auto citr = ctable.find(slot);
+
+    if (citr == ctable.end()) {
+      ctable.emplace(_self, [&](auto& c) {
+        c.slot = slot;
+        c.period = period;
+        c.cumulative = cumulative;
+      });
+    }
+    else {
+      ctable.modify(citr, _self, [&](auto& c) {
+        c.period = period;
+        c.cumulative = cumulative;
+      });
+    }
+
+  }
+
+  //Advance a pair's TWAP accumulator by the previous median over the seconds since the last write. The first
+  //write of a checkpoint period records the cumulative at the start of that period and of every period since
+  //the last write, at most a ring's worth, which is exact since the median did not change in between.
+  //Accumulation starts at 0 with the pair's first non-zero median, and ranges are clamped to that write
+  void update_twap(twaptable& ttable, const name pair, const uint64_t median){
+
+    uint32_t now = current_time_point().sec_since_epoch();
+    uint64_t period = now / delphi::twap_checkpoint_interval;
+
+    auto titr = ttable.find(pair.value);
+
+    if (titr == ttable.end()) {
+
+      if (median == 0) return;
+
+      ttable.emplace(_self, [&](auto& t) {
+        t.pair = pair;
+        t.median = median;
+        t.updated = current_time_point();
+        t.cumulative = 0;
+        t.period = period;
+        t.started = current_time_point();
+      });
+
+      return;
+
+    }
+
+    uint32_t updated = titr->updated.sec_since_epoch();
+
+    if (period > titr->period) {
+
+      checkpointstable ctable(_self, pair.value);
+
+      uint64_t first = std::max(titr->period + 1, period + 1 - std::min(period + 1, delphi::twap_ring_size));
+
+      for (uint64_t p = first; p <= period; p++) {
+        write_checkpoint(ctable, p, titr->cumulative + (uint128_t)titr->median * (p * delphi::twap_checkpoint_interval - updated));
+      }
+
+      TRACE("twap.checkpoint", "pair", pair, "period", period, "written", period - first + 1);
+
+    }
+
+    ttable.modify(titr, _self, [&](auto& t) {
+      t.cumulative += (uint128_t)t.median * (now - updated);
+      t.median = median;
+      t.updated = current_time_point();
+      t.period = period;
     });
 
-    auto gitr =  gtable.begin();
+  }
+
+  //Cross rate of a derived pair from its legs' latest rows, shaped as a latest row. timestamp and samples
+  //are those of the stalest leg
+  latest derive_latest(const derived& d, latesttable& lstore){
+
+    latest out{d.pair, 0, time_point(), 0, d.precision};
+
+    std::vector<delphi::cross_leg> prices;
+    prices.reserve(d.legs.size());
+
+    for (const auto& leg : d.legs) {
+
+      auto litr = lstore.find(leg.pair.value);
+
+      check(litr != lstore.end() && litr->median > 0, "a leg of this pair has no median yet");
+
+      if (prices.empty() || litr->timestamp < out.timestamp) out.timestamp = litr->timestamp;
+      if (prices.empty() || litr->samples < out.samples) out.samples = litr->samples;
+
+      prices.push_back(delphi::cross_leg{litr->median, litr->precision, leg.invert});
+
+    }
+
+    out.median = delphi::cross_rate(prices, d.precision);
+
+    return out;
+
+  }
+
+  //Whether a derived pair is computed from pair
+  bool is_derived_leg(const name pair){
+
+    derivedtable dtable(_self, _self.value);
+
+    for (auto itr = dtable.begin(); itr != dtable.end(); itr++) {
+      for (const auto& leg : itr->legs) if (leg.pair == pair) return true;
+    }
+
+    return false;
+
+  }
+
+  //Apply an oracle's quotes. The config and the oracle's global stats row are loaded once, and the global
+  //datapoints count and stats row are written back once for the whole action. When strict is false, quotes
+  //for pairs that are not active or still in cooldown are skipped instead of failing. Returns the number of
+  //accepted quotes, each with its write_result appended to results
+  uint64_t write_quotes(const name owner, const std::vector<quote>& quotes, const bool strict, std::vector<write_result>& results){
+
+    globaltable gtable(_self, _self.value);
+    statstable gstore(_self, _self.value);
+    pairstatetable pstate(_self, _self.value);
+    windowstable wtable(_self, _self.value);
+    latesttable lstore(_self, _self.value);
+    twaptable ttable(_self, _self.value);
+
+    auto gitr = gtable.begin();
+    auto oitr = gstore.find(owner.value);
+
+    barretention keep = bar_retention(*gitr);
+
+    asset reward = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+    uint64_t accepted = 0;
+
+    for (const auto& q : quotes){
+      TRACE("write.quote", "pair", q.pair, "value", q.value);
+
+      auto itr = load_pairstate(pstate, q.pair);
+
+      bool allowed = itr!=pstate.end() && itr->active == true;
+
+      if (!strict && !allowed) continue;
+      check(allowed, "pair not allowed");
+
+      if (!update_pair_stats(owner, q.pair, *gitr, strict, reward)) continue;
 
-    print("gtable.begin()->total_datapoints_count:", gitr->total_datapoints_count,  "\n");
+      if (itr->bounty_amount>=one_larimer && oitr != gstore.end()){
+
+        //bounty is paid out one larimer per datapoint
+        reward += one_larimer;
+
+        pstate.modify(itr, same_payer, [&]( auto& s ) {
+          s.bounty_amount -= one_larimer;
+        });
+
+      }
+      else if (itr->bounty_awarded==false && itr->bounty_amount<one_larimer){
+
+        pstate.modify(itr, same_payer, [&]( auto& s ) {
+          s.bounty_awarded = true;
+        });
+
+        sync_pair(*itr);
+
+      }
+
+      results.push_back(update_datapoints(owner, q.value, q.pair, wtable, lstore, ttable, *gitr, keep));
+
+      accepted++;
 
-    if (gtable.begin()->total_datapoints_count % gitr->vote_interval == 0){
-      update_votes();
     }
 
+    if (accepted == 0) return 0;
+
+    update_oracle_stats(gstore, oitr, owner, accepted, reward, *gitr);
+    count_datapoints(gtable, gitr, owner, accepted);
+
+    return accepted;
+
   }
 
   //Delphi Oracle - Bounty logic
@@ -803,11 +2898,47 @@ private:
 
   }
 
+  //Add the stake proxied to the contract to a user's score. Returns false when there is nothing to add,
+  //in which case the row is left untouched
+  bool update_user_score(userstable& users, userstable::const_iterator itr, voters_table& vtable){
+
+    auto v_itr = vtable.find(itr->name.value);
+
+    if (v_itr == vtable.end() || v_itr->proxy != _self || v_itr->staked <= 0) return false;
+
+    users.modify(itr, _self, [&]( auto& o ) {
+      o.score += v_itr->staked;
+    });
+
+    return true;
+
+  }
+
+  //Larimers a user donated: the donors aggregate plus the rows from before it existed that compactdons has
+  //not folded yet. Without an aggregate every row is from before it. The walk stops at the first row the
+  //aggregate already counts
+  int64_t donated_total(const name donator){
+
+    donorstable donors(_self, _self.value);
+    donationstable donations(_self, donator.value);
+
+    auto ditr = donors.find(donator.value);
+
+    int64_t total = ditr != donors.end() ? ditr->total.amount : 0;
+    uint64_t counted_from = ditr != donors.end() ? ditr->counted_from : UINT64_MAX;
+
+    for (auto itr = donations.begin(); itr != donations.end() && itr->id < counted_from; itr++) {
+      total += itr->amount.amount;
+    }
+
+    return total;
+
+  }
+
   void process_donation(name from, name scope, asset quantity){
 
-    globaltable gtable(_self, _self.value);
-    statstable cstore(_self, scope.value);
     donationstable donations(_self, from.value);
+    donorstable donors(_self, _self.value);
     userstable users(_self, _self.value);
 
     auto uitr = users.find(from.value);
@@ -821,112 +2952,47 @@ private:
     });
 
     // store donation in table
+    uint64_t id = donations.available_primary_key();
+
     donations.emplace(_self, [&](auto& o) {
-      o.id = donations.available_primary_key();
+      o.id = id;
       o.donator = from;
       o.pair = scope;
       o.timestamp = current_time_point();
       o.amount = quantity;
     });
 
-    auto gitr = gtable.begin();
-
-    uint64_t size = std::distance(cstore.begin(), cstore.end());
-
-    uint64_t upperbound = std::min(size, gitr->paid); //max number of oracles being paid
-
-    auto count_index = cstore.get_index<"count"_n>(); //get list of oracles ranked by number of datapoints contributed for this scope (descending)
-
-    auto itr = count_index.begin();
-
-    uint64_t total_datapoints = 0; //gitr->total_datapoints_count;
-
-    print("upperbound", upperbound, "\n");
-
-    //Move pointer to upperbound, counting total number of datapoints for oracles elligible for payout
-    for (uint64_t i=1;i<=upperbound;i++){
-      total_datapoints+=itr->count;
-
-      if (i<upperbound ){
-        itr++;
-        print("increment 1", "\n");
-
-      }
+    //running total read by voteabuser, rows already in the table are left to compactdons
+    auto ditr = donors.find(from.value);
 
+    if (ditr == donors.end()) {
+      donors.emplace(_self, [&](auto& d) {
+        d.donator = from;
+        d.total = quantity;
+        d.counted_from = id;
+      });
     }
-
-    print("total_datapoints", total_datapoints, "\n"); //total datapoints for the eligible contributors
-
-    uint64_t amount = quantity.amount;
-
-    //Move pointer back to 0, calculating prorated contribution of oracle and allocating proportion of donation
-    for (uint64_t i=upperbound;i>=1;i--){
-
-      uint64_t datapoints = itr->count;
-
-      double percent = ((double)datapoints / (double)total_datapoints) ;
-      uint64_t uquota = (uint64_t)(percent * (double)quantity.amount) ;
-
-      print("itr->owner", itr->owner, "\n");
-      print("datapoints", datapoints, "\n");
-      print("percent", percent, "\n");
-      print("uquota", uquota, "\n");
-
-      asset payout;
-
-      //avoid rounding issues by giving leftovers to top contributor
-      if (i == 1){
-        payout = asset(amount, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
-      }
-      else {
-        payout = asset(uquota, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
-      }
-
-      amount-= uquota;
-
-      print("payout", payout, "\n");
-
-      if (scope == _self) {
-
-        //global donation to the contract, split between top oracles across all pairs
-        cstore.modify(*itr, _self, [&]( auto& s ) {
-          s.balance += payout;
-        });
-
-      }
-      else {
-
-        //donation to a specific pair, split between top oracles of only that pair
-        statstable gstore(_self, _self.value);
-
-        auto optr = gstore.find(itr->owner.value);
-
-        gstore.modify(*optr, _self, [&]( auto& s ) {
-          s.balance += payout;
-        });
-
-      }
-
-      if (i>1 ){
-        itr--;
-        print("decrement 1", "\n");
-
-      } 
+    else {
+      donors.modify(ditr, _self, [&](auto& d) {
+        d.total += quantity;
+      });
     }
 
+    TRACE("donation.accrue", "scope", scope, "amount", quantity);
 
-  }
-
-  void process_bounty(name from, name pair, asset quantity){
+    //oracles collect their share on their next write to the scope or on claim
+    accrue_rewards(scope, quantity.amount);
 
-    pairstable pairs(_self, _self.value);
+  }
 
-    auto pitr = pairs.find(pair.value);
+  void process_bounty(pairstatetable& pstate, pairstatetable::const_iterator itr, asset quantity){
 
-    pairs.modify(*pitr, _self, [&]( auto& s ) {
+    pstate.modify(itr, same_payer, [&]( auto& s ) {
       s.bounty_amount += quantity;
     });
 
+    sync_pair(*itr);
+
   }
 
 };
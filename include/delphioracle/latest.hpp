@@ -0,0 +1,328 @@
+/*
+
+  delphioracle latest price reader
+
+  Header-only helper for contracts that consume DelphiOracle prices. It reads a
+  pair's row of the oracle's latest table with one db_find_i64 and one
+  db_get_i64, without declaring the table or including the oracle's headers.
+
+    delphi::latest_price price;
+    if (delphi::read_latest("delphioracle"_n, "eosusd"_n, price)) {
+      uint64_t usd = delphi::median_as<2>(price); //price in cents
+    }
+
+  Derived pairs are read the same way with read_derived, which computes the
+  cross rate from the latest rows of the pair's legs.
+
+  read_twap gives the time-weighted average median between two times from the
+  pair's price x time accumulator and its checkpoint ring. It reads the twap
+  row, then one checkpoint for each bound that is before the pair's last
+  write, so at most three lookups. It can also return the bounds it used
+  after rounding.
+
+  Published under MIT License
+
+*/
+
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/time.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace delphi {
+
+  //Mirrors a row of the oracle's latest table, always latest_price_size bytes
+  struct latest_price {
+    eosio::name pair;
+    uint64_t median;
+    eosio::time_point timestamp;
+    uint64_t samples;
+    uint64_t precision;
+  };
+
+  static constexpr uint32_t latest_price_size = 40;
+
+  //Length in seconds of a TWAP checkpoint period, and the number of periods the checkpoint ring keeps
+  static constexpr uint64_t twap_checkpoint_interval = 600;
+  static constexpr uint64_t twap_ring_size = 144;
+
+  static constexpr uint32_t twap_size = 56;
+  static constexpr uint32_t checkpoint_size = 32;
+
+  //Powers of ten up to the largest that fits in a uint64_t
+  static constexpr uint64_t pow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull
+  };
+
+  //Powers of ten up to the largest that fits in 128 bits, built at compile time
+  struct pow10_wide_table {
+    unsigned __int128 value[39];
+  };
+
+  constexpr pow10_wide_table make_pow10_wide() {
+    pow10_wide_table t{};
+    t.value[0] = 1;
+    for (int i = 1; i < 39; i++) t.value[i] = t.value[i - 1] * 10;
+    return t;
+  }
+
+  static constexpr pow10_wide_table pow10_wide = make_pow10_wide();
+
+  //Mirrors a leg of a row of the oracle's derived table
+  struct derived_leg {
+    eosio::name pair;
+    bool invert;
+  };
+
+  //A leg's median at its quoted precision, divided into the cross rate instead of multiplied when inverted
+  struct cross_leg {
+    uint64_t median;
+    uint64_t precision;
+    bool invert;
+  };
+
+  inline unsigned __int128 cross_multiply(const unsigned __int128 a, const unsigned __int128 b) {
+    eosio::check(b == 0 || a <= ~(unsigned __int128)0 / b, "cross rate overflows");
+    return a * b;
+  }
+
+  //Product of the legs at precision decimals, truncated. The powers of ten of the legs and of the result
+  //are netted into a single factor so the rate is computed with one integer division
+  inline uint64_t cross_rate(const std::vector<cross_leg>& legs, const uint64_t precision) {
+
+    unsigned __int128 numerator = 1;
+    unsigned __int128 denominator = 1;
+    int64_t exponent = precision;
+
+    for (const auto& leg : legs) {
+      eosio::check(leg.precision < 20, "unsupported quoted precision");
+      eosio::check(leg.median > 0, "cross rate leg has no median");
+      if (leg.invert) {
+        denominator = cross_multiply(denominator, leg.median);
+        exponent += leg.precision;
+      }
+      else {
+        numerator = cross_multiply(numerator, leg.median);
+        exponent -= leg.precision;
+      }
+    }
+
+    eosio::check(exponent > -39 && exponent < 39, "cross rate precision out of range");
+
+    if (exponent >= 0) numerator = cross_multiply(numerator, pow10_wide.value[exponent]);
+    else denominator = cross_multiply(denominator, pow10_wide.value[-exponent]);
+
+    unsigned __int128 rate = numerator / denominator;
+
+    eosio::check(rate <= UINT64_MAX, "cross rate overflows");
+
+    return (uint64_t)rate;
+
+  }
+
+  //Read pair's latest row from the oracle contract. Returns false when the pair has no datapoint yet
+  inline bool read_latest(const eosio::name oracle, const eosio::name pair, latest_price& out) {
+
+    int32_t itr = eosio::internal_use_do_not_use::db_find_i64(oracle.value, oracle.value, eosio::name("latest").value, pair.value);
+
+    if (itr < 0) return false;
+
+    char buffer[latest_price_size];
+
+    int32_t size = eosio::internal_use_do_not_use::db_get_i64(itr, buffer, latest_price_size);
+
+    eosio::check(size == latest_price_size, "unexpected latest row size");
+
+    eosio::datastream<const char*> ds(buffer, latest_price_size);
+    ds >> out.pair >> out.median >> out.timestamp >> out.samples >> out.precision;
+
+    return true;
+
+  }
+
+  //Read a derived pair from the oracle contract and compute its cross rate from its legs' latest rows.
+  //timestamp and samples are those of the stalest leg. Returns false when the pair is not derived or
+  //a leg has no median yet
+  inline bool read_derived(const eosio::name oracle, const eosio::name pair, latest_price& out) {
+
+    int32_t itr = eosio::internal_use_do_not_use::db_find_i64(oracle.value, oracle.value, eosio::name("derived").value, pair.value);
+
+    if (itr < 0) return false;
+
+    int32_t size = eosio::internal_use_do_not_use::db_get_i64(itr, nullptr, 0);
+
+    std::vector<char> buffer(size);
+
+    eosio::internal_use_do_not_use::db_get_i64(itr, buffer.data(), size);
+
+    eosio::datastream<const char*> ds(buffer.data(), size);
+
+    eosio::unsigned_int count;
+    ds >> out.pair >> count;
+
+    std::vector<derived_leg> legs(count.value);
+    for (auto& leg : legs) ds >> leg.pair >> leg.invert;
+
+    ds >> out.precision;
+
+    std::vector<cross_leg> prices;
+    prices.reserve(legs.size());
+
+    for (const auto& leg : legs) {
+
+      latest_price price;
+
+      if (!read_latest(oracle, leg.pair, price) || price.median == 0) return false;
+
+      if (prices.empty() || price.timestamp < out.timestamp) out.timestamp = price.timestamp;
+      if (prices.empty() || price.samples < out.samples) out.samples = price.samples;
+
+      prices.push_back(cross_leg{price.median, price.precision, leg.invert});
+
+    }
+
+    out.median = cross_rate(prices, out.precision);
+
+    return true;
+
+  }
+
+  //Mirrors a row of the oracle's twap table, always twap_size bytes
+  struct twap_state {
+    eosio::name pair;
+    uint64_t median;
+    eosio::time_point updated;
+    unsigned __int128 cumulative;
+    uint64_t period;
+    eosio::time_point started;
+  };
+
+  //Read pair's TWAP accumulator from the oracle contract. Returns false when the pair has no median yet
+  inline bool read_twap_state(const eosio::name oracle, const eosio::name pair, twap_state& out) {
+
+    int32_t itr = eosio::internal_use_do_not_use::db_find_i64(oracle.value, oracle.value, eosio::name("twap").value, pair.value);
+
+    if (itr < 0) return false;
+
+    char buffer[twap_size];
+
+    int32_t size = eosio::internal_use_do_not_use::db_get_i64(itr, buffer, twap_size);
+
+    eosio::check(size == twap_size, "unexpected twap row size");
+
+    eosio::datastream<const char*> ds(buffer, twap_size);
+    ds >> out.pair >> out.median >> out.updated >> out.cumulative >> out.period >> out.started;
+
+    return true;
+
+  }
+
+  //Cumulative median x seconds of a pair at time at, extrapolated from the accumulator when at is not before
+  //the last write, otherwise taken from the checkpoint at the start of the period at falls in. A time before
+  //the pair's first write or in its period is clamped to the first write, where the cumulative is 0. at is
+  //moved to the time the cumulative is for. Returns false when the ring no longer holds that period
+  inline bool read_cumulative(const eosio::name oracle, const twap_state& state, uint32_t& at, unsigned __int128& cumulative) {
+
+    uint32_t updated = state.updated.sec_since_epoch();
+    uint32_t started = state.started.sec_since_epoch();
+
+    if (at >= updated) {
+      cumulative = state.cumulative + (unsigned __int128)state.median * (at - updated);
+      return true;
+    }
+
+    uint64_t period = at / twap_checkpoint_interval;
+
+    if (period <= started / twap_checkpoint_interval) {
+      at = started;
+      cumulative = 0;
+      return true;
+    }
+
+    int32_t itr = eosio::internal_use_do_not_use::db_find_i64(oracle.value, state.pair.value, eosio::name("checkpoints").value, period % twap_ring_size);
+
+    if (itr < 0) return false;
+
+    char buffer[checkpoint_size];
+
+    int32_t size = eosio::internal_use_do_not_use::db_get_i64(itr, buffer, checkpoint_size);
+
+    eosio::check(size == checkpoint_size, "unexpected checkpoint row size");
+
+    uint64_t slot;
+    uint64_t stored;
+
+    eosio::datastream<const char*> ds(buffer, checkpoint_size);
+    ds >> slot >> stored >> cumulative;
+
+    //the slot was overwritten by a later period
+    if (stored != period) return false;
+
+    at = period * twap_checkpoint_interval;
+
+    return true;
+
+  }
+
+  //Time-weighted average median of pair between from and to, at the pair's quoted precision. from is rounded
+  //down to the start of its checkpoint period, and so is to when it is before the pair's last write, and both
+  //are clamped to the pair's first write. used_from and used_to are set to the bounds the average is over.
+  //Returns false when a bound is out of the checkpoint ring or the range is empty
+  inline bool read_twap(const eosio::name oracle, const eosio::name pair, uint32_t from, uint32_t to, uint64_t& out,
+                        uint32_t& used_from, uint32_t& used_to) {
+
+    twap_state state;
+
+    if (!read_twap_state(oracle, pair, state)) return false;
+
+    unsigned __int128 start;
+    unsigned __int128 end;
+
+    if (!read_cumulative(oracle, state, from, start) || !read_cumulative(oracle, state, to, end)) return false;
+
+    if (to <= from) return false;
+
+    out = (uint64_t)((end - start) / (to - from));
+    used_from = from;
+    used_to = to;
+
+    return true;
+
+  }
+
+  //read_twap for callers that do not need the bounds after rounding
+  inline bool read_twap(const eosio::name oracle, const eosio::name pair, uint32_t from, uint32_t to, uint64_t& out) {
+
+    uint32_t used_from;
+    uint32_t used_to;
+
+    return read_twap(oracle, pair, from, to, out, used_from, used_to);
+
+  }
+
+  //Median scaled from the pair's quoted precision to Precision decimals, truncated when Precision is lower
+  template<uint8_t Precision>
+  uint64_t median_as(const latest_price& price) {
+
+    static_assert(Precision < 20, "precision must be below 20");
+
+    eosio::check(price.precision < 20, "unsupported quoted precision");
+
+    if (price.precision >= Precision) return price.median / pow10[price.precision - Precision];
+
+    uint64_t factor = pow10[Precision - price.precision];
+
+    eosio::check(price.median <= UINT64_MAX / factor, "median overflows the requested precision");
+
+    return price.median * factor;
+
+  }
+
+}
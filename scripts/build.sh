@@ -1,3 +1,3 @@
 #!/bin/bash
 
-eosio-cpp -abigen -I ../include/delphioracle -I ../../eosio.contracts/contracts/eosio.system/include -o ../build/delphioracle.wasm ../src/delphioracle.cpp
+cdt-cpp -abigen -I ../include/delphioracle -I ../../eosio.contracts/contracts/eosio.system/include -o ../build/delphioracle.wasm ../src/delphioracle.cpp
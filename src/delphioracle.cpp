@@ -15,57 +15,52 @@
 
 #include <delphioracle.hpp>
 
-//Write datapoint
-ACTION delphioracle::write(const name owner, const std::vector<quote>& quotes) {
+//Write datapoint, returning the new median and window fill of each quoted pair
+std::vector<delphioracle::write_result> delphioracle::write(const name owner, const std::vector<quote>& quotes) {
   
   require_auth(owner);
   
   int length = quotes.size();
 
-  print("length ", length);
+  TRACE("write", "owner", owner, "quotes", length);
 
   check(length>0, "must supply non-empty array of quotes");
   check(check_oracle(owner), "account is not a qualified oracle");
+  check(!check_abuser(owner), "account is flagged as an abuser");
 
-  statstable stable(_self, _self.value);
-  pairstable pairs(_self, _self.value);
+  std::vector<write_result> results;
+  results.reserve(length);
 
-  auto oitr = stable.find(owner.value);
+  write_quotes(owner, quotes, true, results);
 
-  for (int i=0; i<length;i++){
-    print("quote ", i, " ", quotes[i].value, " ",  quotes[i].pair, "\n");
-    
-    auto itr = pairs.find(quotes[i].pair.value);
+  return results;
 
-    check(itr!=pairs.end() && itr->active == true, "pair not allowed");
+}
 
-    check_last_push(owner, quotes[i].pair);
+//Write datapoints for many pairs at once, skipping quotes for pairs that are not active or still in cooldown.
+//Returns a result for each accepted quote
+std::vector<delphioracle::write_result> delphioracle::writebatch(const name owner, const std::vector<quote>& quotes) {
 
-    if (itr->bounty_amount>=one_larimer && oitr != stable.end()){
+  require_auth(owner);
 
-      //global donation to the contract, split between top oracles across all pairs
-      stable.modify(*oitr, _self, [&]( auto& s ) {
-        s.balance += one_larimer;
-      });
+  int length = quotes.size();
 
-      //global donation to the contract, split between top oracles across all pairs
-      pairs.modify(*itr, _self, [&]( auto& s ) {
-        s.bounty_amount -= one_larimer;
-      });
+  TRACE("writebatch", "owner", owner, "quotes", length);
 
-    }
-    else if (itr->bounty_awarded==false && itr->bounty_amount<one_larimer){
+  check(length>0, "must supply non-empty array of quotes");
+  check(check_oracle(owner), "account is not a qualified oracle");
+  check(!check_abuser(owner), "account is flagged as an abuser");
 
-      //global donation to the contract, split between top oracles across all pairs
-      pairs.modify(*itr, _self, [&]( auto& s ) {
-        s.bounty_awarded = true;
-      });
+  std::vector<write_result> results;
+  results.reserve(length);
 
-    }
+  uint64_t accepted = write_quotes(owner, quotes, false, results);
 
-    update_datapoints(owner, quotes[i].value, itr);
+  check(accepted>0, "no quote accepted");
 
-  }
+  TRACE("writebatch.accepted", "count", accepted);
+
+  return results;
 
 }
 
@@ -74,6 +69,7 @@ ACTION delphioracle::writehash(const name owner, const checksum256 hash, const s
   require_auth(owner);
 
   check(check_oracle(owner), "user is not a qualified oracle");
+  check(!check_abuser(owner), "account is flagged as an abuser");
 
   hashestable hstore(_self, _self.value);
 
@@ -96,15 +92,8 @@ ACTION delphioracle::writehash(const name owner, const checksum256 hash, const s
     o_idx.erase(previous_hash);
 
     globaltable gtable(_self, _self.value);
-    auto gitr =  gtable.begin();
 
-    gtable.modify(gitr, _self, [&](auto& s) {
-      s.total_datapoints_count++;
-    });
-
-    if (gtable.begin()->total_datapoints_count % gitr->vote_interval == 0){
-      update_votes();
-    }
+    count_datapoints(gtable, gtable.begin(), owner, 1);
 
   }
   else {
@@ -134,7 +123,10 @@ ACTION delphioracle::forfeithash(name owner) {
 
   auto previous_hash = o_idx.find(owner.value);
 
-  if( previous_hash != o_idx.end() ) o_idx.erase(previous_hash);
+  if( previous_hash != o_idx.end() ) {
+    if (previous_hash->reveal != "") unchain_owner(owner);
+    o_idx.erase(previous_hash);
+  }
 
 }
 
@@ -146,14 +138,33 @@ ACTION delphioracle::claim(name owner) {
   globaltable gtable(_self, _self.value);
   statstable sstore(_self, _self.value);
 
+  rewardstable rtable(_self, _self.value);
+  leaderboardtable ltable(_self, _self.value);
+  settlementstable settled(_self, owner.value);
+
   auto itr = sstore.find(owner.value);
   auto gitr = gtable.begin();
 
   check(itr != sstore.end(), "oracle not found");
-  check( itr->balance.amount > 0, "no rewards to claim" );
 
   asset payout = itr->balance;
 
+  //collect donations not yet settled by a write, from the scopes where the oracle holds a paid place. Each
+  //holder has a settlement row, so only the oracle's own rows are visited. Boards are read as they stand,
+  //one left stale by a change of global::paid is ranked again by the next write to its scope. A scope
+  //without a board has no leaders to pay, it is being torn down or was cleared
+  for (auto sitr = settled.begin(); sitr != settled.end(); sitr++) {
+    auto ritr = rtable.find(sitr->scope.value);
+    auto litr = ltable.find(sitr->scope.value);
+    if (ritr == rtable.end() || litr == ltable.end()) continue;
+    uint64_t paid = std::min<uint64_t>(litr->paid, litr->leaders.size());
+    for (uint64_t i = 0; i < paid; i++) {
+      if (litr->leaders[i].owner == owner) payout.amount += settle_rewards(rtable, ritr, owner, live_count(sitr->scope, owner));
+    }
+  }
+
+  check( payout.amount > 0, "no rewards to claim" );
+
   //if( existing->quantity.amount == quantity.amount ) {
   //   bt.erase( *existing );
   //} else {
@@ -184,8 +195,11 @@ ACTION delphioracle::configure(globalinput g) {
   
   require_auth(_self);
 
+  check(g.datapoints_per_instrument > 0, "datapoints_per_instrument must be greater than 0");
+
   globaltable gtable(_self, _self.value);
   pairstable pairs(_self, _self.value);
+  pairstatetable pstate(_self, _self.value);
 
   auto gitr = gtable.begin();
   auto pitr = pairs.begin();
@@ -228,10 +242,13 @@ ACTION delphioracle::configure(globalinput g) {
 
   }
 
+  //minimum_rank may have changed
+  refresh_oracles();
+
   // Add default pair if not on WAX
   if (pitr == pairs.end() && SYSTEM_SYMBOL != "WAX"){
 
-      pairs.emplace(_self, [&](auto& o) {
+      pitr = pairs.emplace(_self, [&](auto& o) {
         o.active = true;
         o.bounty_awarded = true;
         o.bounty_edited_by_custodians = true;
@@ -247,23 +264,9 @@ ACTION delphioracle::configure(globalinput g) {
         o.quoted_precision = 4;
       });
 
-      datapointstable dstore(_self, name("eosusd"_n).value);
+      create_pairstate(pstate, *pitr, _self);
 
-      //First data point starts at uint64 max
-      uint64_t primary_key = 0;
-     
-      for (uint16_t i=0; i < 21; i++){
-
-        //Insert next datapoint
-        auto c_itr = dstore.emplace(_self, [&](auto& s) {
-          s.id = primary_key;
-          s.value = 0;
-          s.timestamp = NULL_TIME_POINT;
-        });
-
-        primary_key++;
-
-      }
+      create_datapoints(_self, "eosusd"_n, g.datapoints_per_instrument);
 
   }
 
@@ -301,15 +304,20 @@ ACTION delphioracle::newbounty(name proposer, pairinput pair) {
 
   //Add request, proposer pays the RAM for the request + data structure for datapoints & bars. 
 
+  globaltable gtable(_self, _self.value);
   pairstable pairs(_self, _self.value);
-  datapointstable dstore(_self, pair.name.value);
+  pairstatetable pstate(_self, _self.value);
+  derivedtable dtable(_self, _self.value);
 
+  auto gitr = gtable.begin();
   auto itr = pairs.find(pair.name.value);
 
+  check(gitr != gtable.end(), "contract not configured");
   check(pair.name != "system"_n, "Cannot create a pair named system");
   check(itr == pairs.end(), "A pair with this name already exists.");
+  check(dtable.find(pair.name.value) == dtable.end(), "A derived pair with this name already exists.");
 
-  pairs.emplace(proposer, [&](auto& s) {
+  itr = pairs.emplace(proposer, [&](auto& s) {
     s.proposer = proposer;
     s.name = pair.name;
     s.base_symbol = pair.base_symbol;
@@ -321,21 +329,9 @@ ACTION delphioracle::newbounty(name proposer, pairinput pair) {
     s.quoted_precision = pair.quoted_precision;
   });
 
-  //First data point starts at uint64 max
-  uint64_t primary_key = 0;
- 
-  for (uint16_t i=0; i < 21; i++){
-
-    //Insert next datapoint
-    auto c_itr = dstore.emplace(proposer, [&](auto& s) {
-      s.id = primary_key;
-      s.value = 0;
-      s.timestamp = NULL_TIME_POINT;
-    });
+  create_pairstate(pstate, *itr, proposer);
 
-    primary_key++;
-
-  }
+  create_datapoints(proposer, pair.name, gitr->datapoints_per_instrument);
 
 }
 
@@ -343,26 +339,27 @@ ACTION delphioracle::newbounty(name proposer, pairinput pair) {
 ACTION delphioracle::cancelbounty(name name, std::string reason) {
   
   pairstable pairs(_self, _self.value);
-  datapointstable dstore(_self, name.value);
 
   auto itr = pairs.find(name.value);
 
   check(itr != pairs.end(), "bounty doesn't exist");
 
-  print("itr->proposer", itr->proposer, "\n");
+  TRACE("cancelbounty", "pair", name, "proposer", itr->proposer);
 
   check(has_auth(_self) || has_auth(itr->proposer), "missing required authority of contract or proposer");
   check(itr->active == false, "cannot cancel live pair");
+  check(!is_derived_leg(name), "pair is a leg of a derived pair");
 
   //Cancel bounty, post reason to chain.
 
+  //the tombstone is billed to whoever cancels, the contract or the proposer
+  const eosio::name payer = has_auth(_self) ? _self : itr->proposer;
+
   pairs.erase(itr);
 
-  while (dstore.begin() != dstore.end()) {
-      auto ditr = dstore.end();
-      ditr--;
-      dstore.erase(ditr);
-  }
+  request_teardown(name, payer);
+
+  run_teardowns(teardown_batch);
 
   //TODO: Refund accumulated bounty to balance of user
 
@@ -374,88 +371,72 @@ ACTION delphioracle::votebounty(name owner, name bounty) {
   require_auth(owner); 
 
   pairstable pairs(_self, _self.value);
+  custodianstable custodians(_self, _self.value);
+  approvalstable approvals(_self, _self.value);
+  bountytallytable tallies(_self, _self.value);
 
   auto pitr = pairs.find(bounty.value);
 
-  check(!pitr->active, "pair is already active.");
   check(pitr != pairs.end(), "bounty not found.");
+  check(!pitr->active, "pair is already active.");
 
-  custodianstable custodians(_self, _self.value);
-
-  auto itr = custodians.find(owner.value);
-
-  bool vote_approved = false;
-
-  std::string err_msg = "";
-
-  //print("itr->name", itr->name, "\n");
-
-  if (itr != custodians.end()){
-    //voter is custodian
-    print("custodian found \n");
-
-    std::vector<eosio::name> cv = pitr->approving_custodians;
-
-    auto citr = find(cv.begin(), cv.end(), owner);
+  auto titr = load_tally(tallies, pairs, pitr);
 
-    //check(citr == cv.end(), "custodian already voting for bounty");
+  auto a_idx = approvals.get_index<"bountyvoter"_n>();
+  auto aitr = a_idx.find(composite_key(bounty.value, owner.value));
 
-    if (citr == cv.end()){
+  bool voted_custodian = aitr != a_idx.end() && aitr->custodian;
+  bool voted_oracle = aitr != a_idx.end() && aitr->oracle;
 
-      cv.push_back(owner);
+  //voter is custodian
+  bool custodian_vote = !voted_custodian && custodians.find(owner.value) != custodians.end();
 
-      pairs.modify(*pitr, _self, [&]( auto& s ) {
-        s.approving_custodians = cv;
-      });
+  TRACE("votebounty.check_approver", "owner", owner);
 
-      print("custodian added vote \n");
+  bool approver = check_approver(owner);
+  bool oracle_vote = approver && !voted_oracle;
 
-      vote_approved=true;
-      
-    }
-    else err_msg = "custodian already voting for bounty";
+  check(custodian_vote || oracle_vote, approver ? "oracle already voting for bounty" : "owner not a qualified oracle");
 
+  if (aitr == a_idx.end()) {
+    approvals.emplace(_self, [&](auto& a) {
+      a.id = approvals.available_primary_key();
+      a.bounty = bounty;
+      a.voter = owner;
+      a.custodian = custodian_vote;
+      a.oracle = oracle_vote;
+    });
+  }
+  else {
+    a_idx.modify(aitr, _self, [&](auto& a) {
+      if (custodian_vote) a.custodian = true;
+      if (oracle_vote) a.oracle = true;
+    });
   }
 
-  print("checking oracle qualification... \n");
-
-  if (check_approver(owner)) {
+  tallies.modify(titr, _self, [&](auto& t) {
+    if (custodian_vote) t.custodians++;
+    if (oracle_vote) t.oracles++;
+  });
 
-    std::vector<eosio::name> ov = pitr->approving_oracles;
+  TRACE("votebounty.vote", "owner", owner, "custodian", custodian_vote, "oracle", oracle_vote);
 
-    auto oitr = find(ov.begin(), ov.end(), owner);
+  globaltable gtable(_self, _self.value);
 
-    if (oitr == ov.end()){
+  auto gitr = gtable.begin();
 
-      ov.push_back(owner);
+  if (titr->custodians>=gitr->approving_custodians_threshold && titr->oracles>=gitr->approving_oracles_threshold){
+      TRACE("votebounty.activate", "pair", bounty);
 
       pairs.modify(*pitr, _self, [&]( auto& s ) {
-        s.approving_oracles = ov;
+        s.active = true;
       });
 
-      print("oracle added vote \n");
-
-      vote_approved=true;
-
-    }
-    else err_msg = "oracle already voting for bounty";
-
-  }
-  else err_msg = "owner not a qualified oracle";
-
-  check(vote_approved, err_msg.c_str());
-
-  globaltable gtable(_self, _self.value);
-
-  auto gitr = gtable.begin();
-
-  uint64_t approving_custodians_count = std::distance(pitr->approving_custodians.begin(), pitr->approving_custodians.end());
-  uint64_t approving_oracles_count = std::distance(pitr->approving_oracles.begin(), pitr->approving_oracles.end());
+      pairstatetable pstate(_self, _self.value);
 
-  if (approving_custodians_count>=gitr->approving_custodians_threshold && approving_oracles_count>=gitr->approving_oracles_threshold){
-      print("activate bounty", "\n");
+      auto sitr = load_pairstate(pstate, bounty);
 
-      pairs.modify(*pitr, _self, [&]( auto& s ) {
+      pstate.modify(sitr, same_payer, [&]( auto& s ) {
         s.active = true;
       });
 
@@ -469,59 +450,41 @@ ACTION delphioracle::unvotebounty(name owner, name bounty) {
   require_auth(owner); 
 
   pairstable pairs(_self, _self.value);
+  custodianstable custodians(_self, _self.value);
+  approvalstable approvals(_self, _self.value);
+  bountytallytable tallies(_self, _self.value);
 
   auto pitr = pairs.find(bounty.value);
 
-  check(!pitr->active, "pair is already active.");
   check(pitr != pairs.end(), "bounty not found.");
+  check(!pitr->active, "pair is already active.");
 
-  custodianstable custodians(_self, _self.value);
-
-  auto itr = custodians.find(owner.value);
-
-  print("itr->name", itr->name, "\n");
-
-  if (itr != custodians.end()){
-    //voter is custodian
-    print("custodian found \n");
-
-    std::vector<eosio::name> cv = pitr->approving_custodians;
+  auto titr = load_tally(tallies, pairs, pitr);
 
-    auto citr = find(cv.begin(), cv.end(), owner);
+  auto a_idx = approvals.get_index<"bountyvoter"_n>();
+  auto aitr = a_idx.find(composite_key(bounty.value, owner.value));
 
-    check(citr != cv.end(), "custodian is not voting for bounty");
+  //a custodian withdraws its custodian approval, anyone else its oracle approval
+  bool custodian = custodians.find(owner.value) != custodians.end();
 
-    cv.erase(citr);
+  if (custodian) check(aitr != a_idx.end() && aitr->custodian, "custodian is not voting for bounty");
+  else check(aitr != a_idx.end() && aitr->oracle, "not an oracle or oracle is not voting for bounty");
 
-    pairs.modify(*pitr, _self, [&]( auto& s ) {
-      s.approving_oracles = cv;
-    });
+  TRACE("unvotebounty.unvote", "owner", owner, "custodian", custodian);
 
-    print("custodian removed vote \n");
-    
-  }
+  if (custodian ? !aitr->oracle : !aitr->custodian) a_idx.erase(aitr);
   else {
-
-    print("checking oracle qualification... \n");
-
-    //check(check_approver(owner), "owner not a qualified oracle"); // not necessary
-
-    std::vector<eosio::name> ov = pitr->approving_oracles;
-
-    auto oitr = find(ov.begin(), ov.end(), owner);
-
-    check(oitr != ov.end(), "not an oracle or oracle is not voting for bounty");
-
-    ov.erase(oitr);
-
-    pairs.modify(*pitr, _self, [&]( auto& s ) {
-      s.approving_oracles = ov;
+    a_idx.modify(aitr, _self, [&](auto& a) {
+      if (custodian) a.custodian = false;
+      else a.oracle = false;
     });
-
-    print("oracle removed vote \n");
-
   }
 
+  tallies.modify(titr, _self, [&](auto& t) {
+    if (custodian) t.custodians--;
+    else t.oracles--;
+  });
+
 }
 
 //edit a bounty's information
@@ -563,17 +526,17 @@ ACTION delphioracle::deletepair(name name, std::string reason) {
   }
 
   check(reason != "", "Must supply a reason when deleting a pair");
+  check(!is_derived_leg(name), "pair is a leg of a derived pair");
 
-  datapointstable estore(_self, name.value);
-
-  while (estore.begin() != estore.end()) {
-      auto itr = estore.end();
-      itr--;
-      estore.erase(itr);
-  }
+  //the tombstone is billed to whoever deletes, the contract or the proposer
+  const eosio::name payer = has_auth(_self) ? _self : pitr->proposer;
 
   pairs.erase(pitr);
 
+  request_teardown(name, payer);
+
+  run_teardowns(teardown_batch);
+
 }
 
 //add custodian
@@ -623,78 +586,87 @@ ACTION delphioracle::updateusers() {
   userstable users(_self, _self.value);
   voters_table vtable("eosio"_n, name("eosio").value);
 
-  for(auto itr = users.begin(); itr != users.end(); ++itr) {
-
-    // add proxy score
-    auto v_itr = vtable.find(itr->name.value);
-    auto score = itr->score;
-
-    if( v_itr != vtable.end() && v_itr->proxy == _self) {
-      score += v_itr->staked;
-    }
-
-    users.modify(*itr, _self, [&]( auto& o ) {
-      o.score = score;
-    });
-
-  }
+  // add proxy score
+  for(auto itr = users.begin(); itr != users.end(); ++itr) update_user_score(users, itr, vtable);
 
 }
 
-//Clear all data
-ACTION delphioracle::clear(name pair) {
+//Clear all data, at most teardown_batch rows per call. Returns true once everything is erased,
+//until then the owner calls it again
+bool delphioracle::clear(name pair) {
 
   require_auth(_self);
 
   globaltable gtable(_self, _self.value);
   statstable gstore(_self, _self.value);
-  statstable lstore(_self, pair.value);
-  datapointstable estore(_self,  pair.value);
   pairstable pairs(_self, _self.value);
   custodianstable ctable(_self, _self.value);
   hashestable htable(_self, _self.value);
-  
-  while (ctable.begin() != ctable.end()) {
-      auto itr = ctable.end();
-      itr--;
-      ctable.erase(itr);
+  oraclestatetable ostate(_self, _self.value);
+  votestatetable vstate(_self, _self.value);
+  counterstable counters(_self, _self.value);
+  chainstatetable cstate(_self, _self.value);
+  leaderboardtable ltable(_self, _self.value);
+  migrationtable mtable(_self, _self.value);
+  pairstatetable pstate(_self, _self.value);
+  approvalstable approvals(_self, _self.value);
+  bountytallytable tallies(_self, _self.value);
+  latesttable lstore(_self, _self.value);
+  derivedtable dtable(_self, _self.value);
+  twaptable ttable(_self, _self.value);
+  medianstable medians(_self, _self.value);
+  windowstable windows(_self, _self.value);
+
+  //pair's own scopes are erased by the teardown engine, the same way deletepair does it
+  request_teardown(pair, _self);
+
+  uint64_t budget = teardown_batch;
+
+  budget -= erase_rows(ctable, budget);
+  budget -= erase_rows(gtable, budget);
+  budget -= erase_rows(gstore, budget);
+  budget -= erase_count_index(_self, budget);
+
+  //every other pair is torn down too, so none leaves a window behind that a new proposal of it collides with
+  for (auto itr = pairs.begin(); itr != pairs.end() && budget > 0; budget--) {
+    request_teardown(itr->name, _self);
+    itr = pairs.erase(itr);
   }
 
-  while (gtable.begin() != gtable.end()) {
-      auto itr = gtable.end();
-      itr--;
-      gtable.erase(itr);
+  budget -= erase_rows(medians, budget);
+  budget -= erase_rows(windows, budget);
+  budget -= erase_rows(pstate, budget);
+  budget -= erase_rows(approvals, budget);
+  budget -= erase_rows(tallies, budget);
+  budget -= erase_rows(lstore, budget);
+  budget -= erase_rows(dtable, budget);
+  budget -= erase_rows(ttable, budget);
+  budget -= erase_rows(htable, budget);
+
+  //oracles cache is rebuilt on next check
+  budget -= erase_rows(ostate, budget);
+  budget -= erase_rows(vstate, budget);
+  budget -= erase_rows(counters, budget);
+  budget -= erase_rows(mtable, budget);
+
+  //the global leaderboard is ranked again on next use, accumulators keep their index
+  //so settlement rows stay valid
+  auto litr = ltable.find(_self.value);
+  if (litr != ltable.end()) ltable.erase(litr);
+
+  //chaining mode survives, the digests went with the hashes table
+  auto citr = cstate.find(1);
+  if (citr != cstate.end() && citr->synced) {
+    cstate.modify(citr, _self, [&](auto& c) {
+      c.synced = false;
+    });
   }
 
-  while (gstore.begin() != gstore.end()) {
-      auto itr = gstore.end();
-      itr--;
-      gstore.erase(itr);
-  }
+  if (budget > 0) budget = run_teardowns(budget);
 
-  while (lstore.begin() != lstore.end()) {
-      auto itr = lstore.end();
-      itr--;
-      lstore.erase(itr);    
-  }
-  
-  while (estore.begin() != estore.end()) {
-      auto itr = estore.end();
-      itr--;
-      estore.erase(itr);
-  }
-  
-  while (pairs.begin() != pairs.end()) {
-      auto itr = pairs.end();
-      itr--;
-      pairs.erase(itr);
-  }
-  
-  while (htable.begin() != htable.end()) {
-      auto itr = htable.end();
-      itr--;
-      htable.erase(itr);
-  }
+  TRACE("clear", "pair", pair, "done", budget > 0);
+
+  return budget > 0;
 
 }
 
@@ -703,129 +675,661 @@ ACTION delphioracle::voteabuser(const name owner, const name abuser) {
   require_auth(owner);
   check(check_oracle(abuser), "abuser is not a qualified oracle");
 
-  donationstable donations(_self, owner.value);
   voters_table vtable("eosio"_n, name("eosio").value);
 
   // donations
-  auto d_idx = donations.get_index<"donator"_n>();
-  auto d_itr = d_idx.find(owner.value);
-
-  auto total_donated = 0;
-
-  while (d_itr->donator == owner && d_itr != d_idx.end()) {
-    total_donated += d_itr->amount.amount;
-    d_itr++;
-  }
+  int64_t total_donated = donated_total(owner);
 
   auto v_itr = vtable.find(owner.value);
 
   // proxy voting
-  auto total_proxied = 0;
+  int64_t total_proxied = 0;
 
   if( v_itr != vtable.end() && v_itr->proxy == _self) {
     total_proxied += v_itr->staked;
   }
 
-  // TODO: verify user object exists and user has some voting score
   check(total_donated > 0 || total_proxied > 0, "user must donate or proxy vote to delphioracle to vote for abusers");
 
-  print("user: ", owner, " is voting for abuser: ", abuser, " with total stake: ", total_donated + total_proxied);
+  uint64_t stake = total_donated + total_proxied;
+
+  TRACE("voteabuser", "owner", owner, "abuser", abuser, "stake", stake);
+
+  // store data for abuse vote, a repeated vote only moves the tally by the change in stake
+  abusevotestable votes(_self, _self.value);
 
-  // store data for abuse vote
+  auto v_idx = votes.get_index<"voterabuser"_n>();
+  auto vote = v_idx.find(composite_key(owner.value, abuser.value));
+
+  uint64_t previous = 0;
+
+  if (vote == v_idx.end()) {
+    votes.emplace(owner, [&](auto& v) {
+      v.id = votes.available_primary_key();
+      v.voter = owner;
+      v.abuser = abuser;
+      v.stake = stake;
+      v.timestamp = current_time_point();
+    });
+  }
+  else {
+    previous = vote->stake;
+    v_idx.modify(vote, owner, [&](auto& v) {
+      v.stake = stake;
+      v.timestamp = current_time_point();
+    });
+  }
+
+  tally_abuse(abuser, previous, stake);
 
 }
 
-ACTION delphioracle::migratedata() {
+//Copy at most batch rows from delphibackup per call, migrate_batch when none is given, resuming at the
+//cursor held in the migration table. Returns the progress, the owner calls it again until completed is set
+delphioracle::migration delphioracle::migratedata(binary_extension<uint64_t> batch) {
 
   require_auth(_self);
 
-  statstable stats(name("delphibackup"), name("delphibackup").value);
-  statstable _stats(_self, _self.value);
-
-  check(_stats.begin() == _stats.end(), "stats info already exists; call clear first");
-
-  oglobaltable global(name("delphibackup"), name("delphibackup").value);
-  globaltable _global(_self, _self.value);
-
-  auto glitr = global.begin();
-
-  _global.emplace(_self, [&](auto& g){
-    g.id = glitr->id;
-    g.total_datapoints_count = glitr->total_datapoints_count;
-    g.datapoints_per_instrument = 21;
-    g.bars_per_instrument = 30;
-    g.vote_interval = 10000;
-    g.write_cooldown = 55000000;
-    g.approver_threshold = 1;
-    g.approving_oracles_threshold = 2;
-    g.approving_custodians_threshold = 1;
-    g.minimum_rank = 105;
-    g.paid = 21;
-    g.min_bounty_delay = 604800;
-    g.new_bounty_delay = 259200;
+  uint64_t budget = batch.value_or(migrate_batch);
+
+  check(budget > 0, "batch must be greater than 0");
+
+  migrationtable mtable(_self, _self.value);
+
+  auto mitr = mtable.find(1);
+
+  if (mitr == mtable.end() || mitr->stage == migrate_done) {
+
+    statstable _stats(_self, _self.value);
+
+    check(_stats.begin() == _stats.end(), "stats info already exists; call clear first");
+
+    if (mitr != mtable.end()) mtable.erase(mitr);
+
+    mitr = mtable.emplace(_self, [&](auto& m) {
+      m.id = 1;
+      m.started = current_time_point();
+      m.completed = NULL_TIME_POINT;
+    });
+
+  }
+
+  migration m = *mitr;
+
+  uint64_t walked = migrate_walk(m, budget);
+
+  if (m.stage == migrate_done) m.completed = current_time_point();
+
+  TRACE("migratedata", "walked", walked, "stage", (uint64_t)m.stage, "scope", m.scope, "copied", m.copied);
+
+  mtable.modify(mitr, _self, [&](auto& r) {
+    r = m;
   });
 
-  auto gitr = stats.begin();
-  while (gitr != stats.end()) {
-    _stats.emplace(_self, [&](auto& s){
-      s.owner = gitr->owner;
-      s.timestamp = gitr->timestamp;
-      s.count = gitr->count;
-      s.last_claim = gitr->last_claim;
-      s.balance = gitr->balance;
+  return m;
+
+}
+
+//Move a pair's datapoints window into a single packed row
+ACTION delphioracle::packwindow(name pair) {
+
+  require_auth(_self);
+
+  globaltable gtable(_self, _self.value);
+  pairstable pairs(_self, _self.value);
+  windowstable wtable(_self, _self.value);
+  datapointstable dstore(_self, pair.value);
+
+  auto gitr = gtable.begin();
+
+  check(pairs.find(pair.value) != pairs.end(), "pair not found");
+  check(wtable.find(pair.value) == wtable.end(), "pair already uses a packed window");
+
+  std::vector<window_point> points;
+
+  //Oldest first. Placeholder points that were never written are kept, so the median stays the one the
+  //rows layout computes until the window fills
+  auto t_idx = dstore.get_index<"timestamp"_n>();
+
+  for (auto itr = t_idx.begin(); itr != t_idx.end(); itr++) {
+    points.push_back(window_point{itr->owner, itr->value, itr->timestamp});
+  }
+
+  if (points.size() > gitr->datapoints_per_instrument) {
+    points.erase(points.begin(), points.end() - gitr->datapoints_per_instrument);
+  }
+
+  std::vector<uint64_t> sorted;
+  for (const auto& p : points) sorted.push_back(p.value);
+  std::sort(sorted.begin(), sorted.end());
+
+  //bars stay, only the row-per-point window and its sorted medians row are replaced
+  medianstable mtable(_self, _self.value);
+  auto mitr = mtable.find(pair.value);
+  if (mitr != mtable.end()) mtable.erase(mitr);
+
+  erase_rows(dstore, UINT64_MAX);
+
+  wtable.emplace(_self, [&](auto& w) {
+    w.pair = pair;
+    w.cursor = 0;
+    w.median = window_median(sorted);
+    w.points = points;
+    w.sorted = sorted;
+  });
+
+}
+
+//Rebuild the cached set of qualified oracles from the eosio producers table. Returns how many seconds
+//old the replaced set was, so keepers can see how stale writes were allowed to get
+uint64_t delphioracle::syncoracles() {
+
+  return refresh_oracles();
+
+}
+
+//Send the producer vote requested by the write path, anyone can call it once it is due
+ACTION delphioracle::refreshvotes() {
+
+  update_votes();
+
+}
+
+//Switch multiparty chaining between raw digest bytes and the original hex encoding
+ACTION delphioracle::setchainmode(bool hex) {
+
+  require_auth(_self);
+
+  chainstatetable cstate(_self, _self.value);
+
+  auto citr = cstate.find(1);
+
+  if (citr == cstate.end()) {
+    cstate.emplace(_self, [&](auto& c) {
+      c.id = 1;
+      c.hex_chaining = hex;
+    });
+  }
+  else {
+    cstate.modify(citr, _self, [&](auto& c) {
+      c.hex_chaining = hex;
     });
-    gitr++;
   }
 
-  npairstable pairs(name("delphibackup"), name("delphibackup").value);
-  pairstable _pairs(_self, _self.value);
-  auto pitr = pairs.begin();
-  while (pitr != pairs.end()) {
-    _pairs.emplace(_self, [&](auto& p){
-      p.active = pitr->active;
-      p.bounty_awarded = pitr->bounty_awarded;
-      p.bounty_edited_by_custodians = pitr->bounty_edited_by_custodians;
-      p.proposer = pitr->proposer;
-      p.name = pitr->name;
-      p.bounty_amount = pitr->bounty_amount;
-      p.base_symbol =  pitr->base_symbol;
-      p.base_type = pitr->base_type;
-      p.base_contract = pitr->base_contract;
-      p.quote_symbol = pitr->quote_symbol;
-      p.quote_type = pitr->quote_type;
-      p.quote_contract = pitr->quote_contract;
-      p.quoted_precision = pitr->quoted_precision;
+}
+
+//Score at most batch users per call, resuming where the previous call stopped. Returns the sweep state,
+//the owner calls it again while running is set
+delphioracle::sweepstate delphioracle::sweepusers(uint64_t batch) {
+
+  require_auth(_self);
+
+  check(batch > 0 && batch <= sweep_users_max_batch, "batch must be between 1 and 500");
+
+  userstable users(_self, _self.value);
+  voters_table vtable("eosio"_n, name("eosio").value);
+  sweepstatetable sstate(_self, _self.value);
+
+  auto sitr = sstate.find(1);
+
+  if (sitr == sstate.end()) {
+    sitr = sstate.emplace(_self, [&](auto& s) {
+      s.id = 1;
+      s.completed = NULL_TIME_POINT;
     });
+  }
 
-    statstable pstats(name("delphibackup"), pitr->name.value);
-    statstable _pstats(_self, pitr->name.value);
-    auto sitr = pstats.begin();
-    while (sitr != pstats.end()) {
-      _pstats.emplace(_self, [&](auto& s){
-        s.owner = sitr->owner;
-        s.timestamp = sitr->timestamp;
-        s.count = sitr->count;
-        s.last_claim = sitr->last_claim;
-        s.balance = sitr->balance;
-      });
-      sitr++;
+  if (!sitr->running) {
+    sstate.modify(sitr, _self, [&](auto& s) {
+      s.running = true;
+      s.cursor = name();
+      s.updated = 0;
+      s.started = current_time_point();
+    });
+  }
+
+  auto itr = users.lower_bound(sitr->cursor.value);
+  uint64_t updated = 0;
+
+  for (uint64_t i = 0; i < batch && itr != users.end(); i++, itr++) {
+    if (update_user_score(users, itr, vtable)) updated++;
+  }
+
+  bool done = itr == users.end();
+
+  TRACE("sweepusers", "from", sitr->cursor, "updated", updated, "done", done);
+
+  sstate.modify(sitr, _self, [&](auto& s) {
+    s.running = !done;
+    s.cursor = done ? name() : itr->name;
+    s.updated += updated;
+    if (done) s.completed = current_time_point();
+  });
+
+  return *sitr;
+
+}
+
+//Keep erasing the scopes of torn down pairs, at most batch rows per call. Returns the number of pairs
+//still listed, anyone can call it again until none are left
+uint64_t delphioracle::teardown(uint64_t batch) {
+
+  check(batch > 0 && batch <= teardown_max_batch, "batch must be between 1 and 1000");
+
+  teardownstable teardowns(_self, _self.value);
+
+  check(teardowns.begin() != teardowns.end(), "no pair to tear down");
+
+  run_teardowns(batch);
+
+  return std::distance(teardowns.begin(), teardowns.end());
+
+}
+
+//Fold at most batch of a donator's oldest donation rows into its aggregate and erase them. Rows from
+//before the aggregate existed are always folded, later ones once older than donation_retention.
+//Called by the donator, or by the contract for past donators after an upgrade
+ACTION delphioracle::compactdons(name donator, uint64_t batch) {
+
+  check(has_auth(donator) || has_auth(_self), "missing required authority of donator or contract");
+  check(batch > 0 && batch <= compact_max_batch, "batch must be between 1 and 1000");
+
+  donationstable donations(_self, donator.value);
+  donorstable donors(_self, _self.value);
+
+  auto itr = donations.begin();
+
+  check(itr != donations.end(), "no donations to compact");
+
+  auto ditr = donors.find(donator.value);
+
+  if (ditr == donors.end()) {
+    ditr = donors.emplace(_self, [&](auto& d) {
+      d.donator = donator;
+      d.total = asset(0, symbol(SYSTEM_SYMBOL, SYSTEM_PRECISION));
+      d.counted_from = donations.available_primary_key();
+    });
+  }
+
+  time_point cutoff = current_time_point() - seconds(donation_retention);
+  asset folded = asset(0, ditr->total.symbol);
+  uint64_t erased = 0;
+
+  while (itr != donations.end() && erased < batch) {
+
+    if (itr->id < ditr->counted_from) {
+      check(itr->amount.symbol == folded.symbol, "donation in another symbol than the total");
+      folded += itr->amount;
     }
+    else if (itr->timestamp > cutoff) break;
 
-    datapointstable datapoints(name("delphibackup"), pitr->name.value);
-    datapointstable _datapoints(_self, pitr->name.value);
-    auto ditr = datapoints.begin();
-    while (ditr != datapoints.end()) {
-      _datapoints.emplace(_self, [&](auto& d){
-        d.id = ditr->id;
-        d.owner = ditr->owner;
-        d.value = ditr->value;
-        d.median = ditr->median;
-        d.timestamp = ditr->timestamp;
-      });
-      ditr++;
+    itr = donations.erase(itr);
+    erased++;
+
+  }
+
+  check(erased > 0, "no donations to compact");
+
+  TRACE("compactdons", "donator", donator, "erased", erased, "folded", folded);
+
+  if (folded.amount > 0) {
+    donors.modify(ditr, _self, [&](auto& d) {
+      d.total += folded;
+    });
+  }
+
+}
+
+//Withdraw an abuse vote, taking its stake off the abuser's tally
+ACTION delphioracle::unvoteabuser(const name owner, const name abuser) {
+
+  require_auth(owner);
+
+  abusevotestable votes(_self, _self.value);
+
+  auto v_idx = votes.get_index<"voterabuser"_n>();
+  auto vote = v_idx.find(composite_key(owner.value, abuser.value));
+
+  check(vote != v_idx.end(), "no vote against this abuser");
+
+  uint64_t stake = vote->stake;
+
+  v_idx.erase(vote);
+
+  tally_abuse(abuser, stake, 0);
+
+}
+
+//Set the stake voted against an oracle at which write rejects it, 0 turns flagging off. Only the
+//oracles already voted against are flagged again
+ACTION delphioracle::setabuse(uint64_t threshold) {
+
+  require_auth(_self);
+
+  abusestatetable astate(_self, _self.value);
+  abuserstable atable(_self, _self.value);
+
+  auto itr = astate.find(1);
+
+  if (itr == astate.end()) {
+    astate.emplace(_self, [&](auto& a) {
+      a.id = 1;
+      a.threshold = threshold;
+    });
+  }
+  else {
+    astate.modify(itr, _self, [&](auto& a) {
+      a.threshold = threshold;
+    });
+  }
+
+  for (auto aitr = atable.begin(); aitr != atable.end(); aitr++) {
+    bool flagged = threshold > 0 && aitr->votes >= threshold;
+    if (aitr->flagged == flagged) continue;
+    atable.modify(aitr, _self, [&](auto& a) {
+      a.flagged = flagged;
+    });
+  }
+
+}
+
+//Set how many bars the minute, hour and day tiers keep. A tier lowered below its current size is trimmed
+//by the next bar it opens
+ACTION delphioracle::setretention(uint64_t minute, uint64_t hour, uint64_t day) {
+
+  require_auth(_self);
+
+  retentiontable rstore(_self, _self.value);
+
+  auto itr = rstore.find(1);
+
+  if (itr == rstore.end()) {
+    rstore.emplace(_self, [&](auto& r) {
+      r.id = 1;
+      r.minute = minute;
+      r.hour = hour;
+      r.day = day;
+    });
+  }
+  else {
+    rstore.modify(itr, _self, [&](auto& r) {
+      r.minute = minute;
+      r.hour = hour;
+      r.day = day;
+    });
+  }
+
+}
+
+//Create the hot state row of at most batch pairs from before the split. Writes create a missing row on
+//their own, this only spares the first quotes after an upgrade the extra row
+ACTION delphioracle::splitpairs(uint64_t batch) {
+
+  require_auth(_self);
+
+  check(batch > 0, "batch must be greater than 0");
+
+  pairstable pairs(_self, _self.value);
+  pairstatetable pstate(_self, _self.value);
+
+  uint64_t created = 0;
+
+  for (auto pitr = pairs.begin(); pitr != pairs.end() && created < batch; pitr++) {
+    if (pstate.find(pitr->name.value) != pstate.end()) continue;
+    create_pairstate(pstate, *pitr, _self);
+    created++;
+  }
+
+  check(created > 0, "every pair already has its state row");
+
+  TRACE("splitpairs", "created", created);
+
+}
+
+//Erase at most batch entries of the stats count index left over from before the leaderboard, global
+//scope first and then each pair's. Pairs deleted since are cleaned by the teardown
+ACTION delphioracle::dropcountidx(uint64_t batch) {
+
+  require_auth(_self);
+
+  check(batch > 0, "batch must be greater than 0");
+
+  pairstable pairs(_self, _self.value);
+
+  uint64_t budget = batch;
+
+  budget -= erase_count_index(_self, budget);
+
+  for (auto pitr = pairs.begin(); pitr != pairs.end() && budget > 0; pitr++) {
+    budget -= erase_count_index(pitr->name, budget);
+  }
+
+  check(budget < batch, "no count index entries left");
+
+  TRACE("dropcountidx", "erased", batch - budget);
+
+}
+
+//Define a pair computed from the medians of pairs oracles already write, or replace its legs. Each leg
+//multiplies the cross rate by its median, or divides it when inverted
+ACTION delphioracle::setderived(name pair, std::vector<derived_leg> legs, uint64_t precision) {
+
+  require_auth(_self);
+
+  pairstable pairs(_self, _self.value);
+  derivedtable dtable(_self, _self.value);
+
+  check(pairs.find(pair.value) == pairs.end(), "a fed pair with this name already exists");
+  check(legs.size() >= 2 && legs.size() <= derived_max_legs, "a derived pair needs between 2 and 4 legs");
+  check(precision < 20, "precision must be below 20");
+
+  for (auto itr = legs.begin(); itr != legs.end(); itr++) {
+    auto pitr = pairs.find(itr->pair.value);
+    check(pitr != pairs.end(), "leg is not a fed pair");
+    check(pitr->active, "leg is not an active pair");
+    for (auto prev = legs.begin(); prev != itr; prev++) check(prev->pair != itr->pair, "duplicate leg");
+  }
+
+  auto ditr = dtable.find(pair.value);
+
+  if (ditr == dtable.end()) {
+    dtable.emplace(_self, [&](auto& d) {
+      d.pair = pair;
+      d.legs = legs;
+      d.precision = precision;
+    });
+  }
+  else {
+    dtable.modify(ditr, _self, [&](auto& d) {
+      d.legs = legs;
+      d.precision = precision;
+    });
+  }
+
+  TRACE("setderived", "pair", pair, "legs", (uint64_t)legs.size(), "precision", precision);
+
+}
+
+//Remove a derived pair
+ACTION delphioracle::delderived(name pair) {
+
+  require_auth(_self);
+
+  derivedtable dtable(_self, _self.value);
+
+  auto itr = dtable.find(pair.value);
+
+  check(itr != dtable.end(), "derived pair not found");
+
+  dtable.erase(itr);
+
+}
+
+//Latest median of a pair
+delphioracle::latest delphioracle::getlatest(name pair) {
+
+  latesttable lstore(_self, _self.value);
+
+  auto itr = lstore.find(pair.value);
+
+  check(itr != lstore.end(), "no datapoint for this pair yet");
+
+  return *itr;
+
+}
+
+//Current window of a pair, from the packed row when the pair has one
+delphioracle::window_view delphioracle::getwindow(name pair) {
+
+  windowstable wtable(_self, _self.value);
+
+  window_view view{pair, 0, {}};
+
+  auto witr = wtable.find(pair.value);
+
+  if (witr != wtable.end()) {
+
+    //the ring buffer starts at cursor, the oldest point
+    uint64_t size = witr->points.size();
+
+    for (uint64_t i = 0; i < size; i++) view.points.push_back(witr->points[(witr->cursor + i) % size]);
+
+    view.median = witr->median;
+
+    return view;
+
+  }
+
+  datapointstable dstore(_self, pair.value);
+
+  auto t_idx = dstore.get_index<"timestamp"_n>();
+
+  check(t_idx.begin() != t_idx.end(), "pair not found");
+
+  for (auto itr = t_idx.begin(); itr != t_idx.end(); itr++) {
+    view.points.push_back(window_point{itr->owner, itr->value, itr->timestamp});
+    view.median = itr->median;
+  }
+
+  return view;
+
+}
+
+//Bars of a pair opened between from and to in the minute, hour or day tier
+std::vector<delphioracle::bars> delphioracle::getbars(name pair, name tier, time_point_sec from, time_point_sec to, uint32_t limit) {
+
+  check(limit > 0 && limit <= query_max_bars, "limit must be between 1 and 500");
+
+  if (tier == "minute"_n) {
+    barstable bstore(_self, pair.value);
+    return collect_bars(bstore, from, to, limit);
+  }
+  else if (tier == "hour"_n) {
+    hourbarstable bstore(_self, pair.value);
+    return collect_bars(bstore, from, to, limit);
+  }
+
+  check(tier == "day"_n, "tier must be minute, hour or day");
+
+  daybarstable bstore(_self, pair.value);
+
+  return collect_bars(bstore, from, to, limit);
+
+}
+
+//Oracles with the most datapoints in a scope, _self for the global board
+delphioracle::leaderboard delphioracle::getleaders(name scope) {
+
+  leaderboardtable ltable(_self, _self.value);
+
+  auto itr = ltable.find(scope.value);
+
+  check(itr != ltable.end(), "no leaderboard for this scope yet");
+
+  leaderboard board = *itr;
+
+  //the board only keeps lower bounds of the counts
+  for (auto& l : board.leaders) l.count = live_count(scope, l.owner);
+
+  return board;
+
+}
+
+//An oracle's stats in a scope, with the donation share it has not collected yet. Nothing is settled
+delphioracle::oracle_view delphioracle::getstats(name owner, name scope) {
+
+  statstable gstore(_self, scope.value);
+
+  auto sitr = gstore.find(owner.value);
+
+  check(sitr != gstore.end(), "no stats for this oracle in this scope");
+
+  oracle_view view{owner, scope, sitr->count, sitr->timestamp, sitr->balance, 0, asset(0, sitr->balance.symbol)};
+
+  leaderboardtable ltable(_self, _self.value);
+
+  auto litr = ltable.find(scope.value);
+
+  if (litr == ltable.end()) return view;
+
+  for (uint64_t i = 0; i < litr->leaders.size(); i++) {
+
+    if (litr->leaders[i].owner != owner) continue;
+
+    view.rank = i + 1;
+
+    rewardstable rtable(_self, _self.value);
+    settlementstable settled(_self, owner.value);
+
+    auto ritr = rtable.find(scope.value);
+    auto stitr = settled.find(scope.value);
+
+    if (i < litr->paid && ritr != rtable.end()) {
+      view.pending.amount = rewards_owed(*ritr, stitr != settled.end() ? stitr->index : 0, sitr->count);
     }
 
-    pitr++;
+    break;
+
   }
 
+  return view;
+
 }
+
+//Cross rate of a derived pair, computed from the latest medians of its legs
+delphioracle::latest delphioracle::getderived(name pair) {
+
+  derivedtable dtable(_self, _self.value);
+  latesttable lstore(_self, _self.value);
+
+  auto itr = dtable.find(pair.value);
+
+  check(itr != dtable.end(), "derived pair not found");
+
+  return derive_latest(*itr, lstore);
+
+}
+
+//Time-weighted average median of a pair between two times, over the same bounds as delphi::read_twap. from
+//is rounded down to the start of its checkpoint period, and so is to when it is before the pair's last write,
+//and both are clamped to the pair's first write
+delphioracle::twap_view delphioracle::gettwap(name pair, time_point_sec from, time_point_sec to) {
+
+  delphi::twap_state state;
+
+  check(delphi::read_twap_state(_self, pair, state), "no median for this pair yet");
+
+  uint32_t start_at = from.sec_since_epoch();
+  uint32_t end_at = to.sec_since_epoch();
+
+  uint128_t start;
+  uint128_t end;
+
+  check(delphi::read_cumulative(_self, state, start_at, start), "from is out of the checkpoint ring");
+  check(delphi::read_cumulative(_self, state, end_at, end), "to is out of the checkpoint ring");
+  check(end_at > start_at, "range is empty after rounding");
+
+  return twap_view{pair, time_point_sec(start_at), time_point_sec(end_at), (uint64_t)((end - start) / (end_at - start_at))};
+
+}
+